@@ -0,0 +1,756 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Headless benchmark for ChorusFlangerAudioProcessor::processBlock.
+
+    Drives the processor with synthetic buffers over a matrix of channel counts,
+    sample rates, block sizes, effect types, chorus voices, oversampling factors, interpolators,
+    automation patterns, input signals, host precisions and delay storage precisions, and reports
+    ns/sample (mean, p99, max) plus how many instances fit on one core before
+    the p99 call misses the buffer deadline.
+
+    Usage:
+      ChorusFlangerBenchmark [--channels=1,2,6] [--rates=44100,96000] [--blocks=64,512] [--types=chorus,flanger]
+                             [--voices=1,4,8] [--oversampling=1,2,4] [--interpolation=linear,hermite,lagrange,thiran]
+                             [--automation=static,sweep,storm] [--input=noise,silence] [--precision=float,double]
+                             [--storage=32,64,16] [--bypass=off,fed,sleep] [--seconds=0.5] [--deadline=1.0]
+                             [--bank-streams=256] [--bank-threads=1,2,4]
+                             [--json=results.json | --json=-] [--label=<commit>] [--trace=trace.json]
+
+    --deadline is the share of each buffer period the plugin may use (1.0 = all of it).
+    --input=silence measures an idle instance, once its tail has died away.
+    --precision is the host's sample type (which processBlock is called), --storage the delay core's.
+    --bypass=fed,sleep measures an instance the host has bypassed, in each bypass mode, once it has faded out.
+
+    Built with CHORUSFLANGER_PROFILING (the Profile configuration) it also reports each stage's
+    p50/p99/max latency per block, and --trace writes the first configuration's timed blocks as
+    Chrome/Perfetto trace event JSON.
+
+    --json=- writes the JSON to stdout and the tables to stderr, so stdout can be piped straight
+    into a JSON tool.
+
+    The instantiation section times creating and preparing a bare ChorusFlangerEngine against the whole
+    plugin processor around it, and the events section the engine with 0 to 512 timestamped parameter
+    changes per 512 sample block.
+
+    The stream bank section runs --bank-streams independent stereo streams (0 skips it) on each of
+    --bank-threads thread counts, with every tick due within one block period, and reports tick
+    times, streams per core, scaling against one thread and streams that missed the deadline.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../Source/PluginProcessor.h"
+#include "../../Source/StreamBank.h"
+
+//==============================================================================
+// Parameter order, as added in the ChorusFlangerAudioProcessor constructor
+enum ParameterIndex
+{
+    dryWetIndex = 0,
+    depthIndex,
+    rateIndex,
+    phaseOffsetIndex,
+    feedbackIndex,
+    typeIndex,
+    voicesIndex,
+    oversamplingIndex,
+    interpolationIndex,
+    delayPrecisionIndex
+};
+
+struct BenchmarkConfig
+{
+    int numChannels;
+    double sampleRate;
+    int blockSize;
+    int type; // 0 = chorus, 1 = flanger
+    int numVoices; // chorus only
+    int oversamplingFactor; // 1, 2 or 4
+    int interpolation; // index into interpolationNames
+    String automation; // static, sweep or storm
+    String input; // noise or silence
+    bool doublePrecision; // host buffers are double
+    int delayPrecision; // 0 = 32 bit, 1 = 64 bit, 2 = 16 bit delay storage
+    String bypass; // off, fed or sleep - host bypass, and the bypass mode it runs in
+};
+
+// Interpolator names, in parameter order
+static const StringArray interpolationNames { "linear", "hermite", "lagrange", "thiran" };
+static const int storageBits[NUM_DELAY_PRECISIONS] = { 32, 64, 16 }; // by delay precision parameter value
+
+// Where the tables go - stderr when the JSON has stdout
+static std::ostream* table = &std::cout;
+
+struct BenchmarkResult
+{
+    double meanNsPerSample;
+    double p99NsPerSample;
+    double maxNsPerSample;
+    double instancesPerCore; // at the p99 call time
+    var stages; // per-stage latencies, in profiling builds
+};
+
+//==============================================================================
+static void setParameter(AudioProcessor& processor, int index, float normalisedValue)
+{
+    processor.getParameters().getUnchecked(index)->setValueNotifyingHost(normalisedValue);
+}
+
+// Moves the parameters for one block, the way a host would between callbacks
+static void applyAutomation(AudioProcessor& processor, const String& automation, int blockIndex, int numBlocks, Random& random)
+{
+    if (automation == "sweep") {
+        // Slow smooth automation - a few cycles over the whole run
+        float position = (float)blockIndex / (float)numBlocks;
+        float sweep = 0.5f + 0.5f * std::sin(2 * MathConstants<float>::pi * 4 * position);
+
+        setParameter(processor, depthIndex, sweep);
+        setParameter(processor, feedbackIndex, 1 - sweep);
+        setParameter(processor, dryWetIndex, 0.25f + 0.5f * sweep);
+        setParameter(processor, rateIndex, sweep);
+    }
+    else if (automation == "storm") {
+        // Every continuous parameter jumps to a new value every block
+        setParameter(processor, dryWetIndex, random.nextFloat());
+        setParameter(processor, depthIndex, random.nextFloat());
+        setParameter(processor, rateIndex, random.nextFloat());
+        setParameter(processor, phaseOffsetIndex, random.nextFloat());
+        setParameter(processor, feedbackIndex, random.nextFloat());
+    }
+}
+
+template <typename SampleType>
+static BenchmarkResult runBenchmark(const BenchmarkConfig& config, double seconds, double deadlineFraction, const String& tracePath)
+{
+    ChorusFlangerAudioProcessor processor;
+    processor.setPlayConfigDetails(config.numChannels, config.numChannels, config.sampleRate, config.blockSize);
+    processor.setProcessingPrecision(std::is_same<SampleType, double>::value ? AudioProcessor::doublePrecision
+                                                                              : AudioProcessor::singlePrecision);
+
+    setParameter(processor, dryWetIndex, 0.5f);
+    setParameter(processor, depthIndex, 0.5f);
+    setParameter(processor, feedbackIndex, 0.5f);
+    setParameter(processor, typeIndex, (float)config.type);
+    setParameter(processor, voicesIndex, (float)(config.numVoices - 1) / (MAX_VOICES - 1)); // 1 to MAX_VOICES
+    setParameter(processor, oversamplingIndex, (float)roundToInt(std::log2(config.oversamplingFactor)) / MAX_OVERSAMPLING_ORDER);
+    setParameter(processor, interpolationIndex, (float)config.interpolation / (NUM_INTERPOLATORS - 1));
+    setParameter(processor, delayPrecisionIndex, (float)config.delayPrecision / (NUM_DELAY_PRECISIONS - 1));
+
+    processor.setBypassMode((config.bypass == "sleep") ? ChorusFlangerAudioProcessor::BypassMode::sleep
+                                                       : ChorusFlangerAudioProcessor::BypassMode::keepFed);
+    processor.prepareToPlay(config.sampleRate, config.blockSize);
+
+    // Synthetic input - noise or silence, copied into the work buffer before every call since processing is in place
+    Random random(0x5eed);
+    AudioBuffer<SampleType> input(config.numChannels, config.blockSize);
+    AudioBuffer<SampleType> buffer(config.numChannels, config.blockSize);
+    MidiBuffer midi;
+
+    // The callback the host makes - the warm up is longer than the bypass fade, so bypassed blocks are timed faded out
+    const bool bypassed = (config.bypass != "off");
+
+    auto process = [&] {
+        if (bypassed) {
+            processor.processBlockBypassed(buffer, midi);
+        }
+        else {
+            processor.processBlock(buffer, midi);
+        }
+    };
+
+    for (int channel = 0; channel < config.numChannels; channel++) {
+        for (int i = 0; i < config.blockSize; i++) {
+            input.setSample(channel, i, (config.input == "silence") ? SampleType(0) : SampleType(random.nextFloat() * 2 - 1));
+        }
+    }
+
+    // Warm up caches and smoothing, untimed - long enough for a silent instance to go to sleep
+    int numWarmUpBlocks = jmax(16, (int)(0.1 * config.sampleRate / config.blockSize));
+
+    if (config.input == "silence") {
+        numWarmUpBlocks += (int)(processor.getTailLengthSeconds() * config.sampleRate / config.blockSize) + 1;
+    }
+
+    for (int block = 0; block < numWarmUpBlocks; block++) {
+        buffer.makeCopyOf(input, true);
+        process();
+    }
+
+    int numBlocks = jmax(64, (int)(seconds * config.sampleRate / config.blockSize));
+
+   #if CHORUSFLANGER_PROFILING
+    // Only the timed blocks count
+    auto& profiler = processor.getProfiler();
+    profiler.reset();
+
+    if (tracePath.isNotEmpty()) {
+        profiler.requestTrace(numBlocks);
+    }
+   #else
+    ignoreUnused(tracePath);
+   #endif
+
+    std::vector<double> nsPerSample;
+    nsPerSample.reserve((size_t)numBlocks);
+
+    for (int block = 0; block < numBlocks; block++) {
+        applyAutomation(processor, config.automation, block, numBlocks, random);
+        buffer.makeCopyOf(input, true);
+
+        int64 start = Time::getHighResolutionTicks();
+        process();
+        int64 end = Time::getHighResolutionTicks();
+
+        nsPerSample.push_back(Time::highResolutionTicksToSeconds(end - start) * 1.0e9 / config.blockSize);
+    }
+
+    BenchmarkResult result;
+
+   #if CHORUSFLANGER_PROFILING
+    Array<var> stages;
+
+    for (int stage = 0; stage < NUM_PROFILE_STAGES; stage++) {
+        ProfileStats stats = profiler.getStats(stage);
+
+        auto* entry = new DynamicObject();
+        entry->setProperty("stage", Profiler::getStageName(stage));
+        entry->setProperty("p50Us", stats.p50);
+        entry->setProperty("p99Us", stats.p99);
+        entry->setProperty("maxUs", stats.max);
+        stages.add(var(entry));
+    }
+
+    result.stages = stages;
+
+    if (tracePath.isNotEmpty()) {
+        File traceFile = File::getCurrentWorkingDirectory().getChildFile(tracePath);
+        traceFile.deleteFile();
+        FileOutputStream stream(traceFile);
+
+        if (! stream.openedOk() || ! profiler.writeTrace(stream)) {
+            std::cerr << "Could not write " << tracePath << std::endl;
+        }
+    }
+   #endif
+
+    processor.releaseResources();
+
+    double total = 0;
+    for (double ns : nsPerSample) {
+        total += ns;
+    }
+    result.meanNsPerSample = total / nsPerSample.size();
+
+    std::sort(nsPerSample.begin(), nsPerSample.end());
+    result.p99NsPerSample = nsPerSample[(size_t)((nsPerSample.size() - 1) * 0.99)];
+    result.maxNsPerSample = nsPerSample.back();
+
+    // Instances one core can run before the p99 call no longer fits in the share of the buffer period we are given
+    double deadlineNs = deadlineFraction * 1.0e9 * config.blockSize / config.sampleRate;
+    result.instancesPerCore = deadlineNs / (result.p99NsPerSample * config.blockSize);
+
+    return result;
+}
+
+//==============================================================================
+// Speed of each LFO back end, and its largest error against a double precision sin()
+static var benchmarkLFOs()
+{
+    struct LFOConfig { const char* name; LFO::Mode mode; int interval; };
+
+    const LFOConfig configs[] = {
+        { "sine", LFO::Mode::sine, 1 },
+        { "quadrature", LFO::Mode::quadrature, 1 },
+        { "wavetable", LFO::Mode::wavetable, 1 },
+        { "quadrature/16", LFO::Mode::quadrature, 16 },
+        { "wavetable/16", LFO::Mode::wavetable, 16 }
+    };
+
+    const double sampleRate = 44100.0;
+    const float frequency = 7.3f;
+    const int blockSize = 64;
+    const int numBlocks = (int)(60 * sampleRate / blockSize);
+
+    HeapBlock<float> sinOut(blockSize), cosOut(blockSize);
+    Array<var> results;
+
+    *table << std::endl << "LFO back ends (44.1 kHz, 7.3 Hz, 60 s)" << std::endl;
+
+    for (auto& config : configs) {
+        LFO lfo;
+        lfo.setMode(config.mode);
+        lfo.setControlRateInterval(config.interval);
+        lfo.prepare(sampleRate);
+        lfo.setFrequency(frequency);
+
+        // Speed
+        volatile float sink = 0; // keeps the optimiser from dropping the loop
+        int64 start = Time::getHighResolutionTicks();
+
+        for (int block = 0; block < numBlocks; block++) {
+            lfo.process(sinOut, cosOut, blockSize);
+            sink = sinOut[blockSize - 1];
+        }
+
+        double ns = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start) * 1.0e9 / ((double)numBlocks * blockSize);
+
+        // Accuracy
+        lfo.reset();
+        double phase = 0;
+        double maxError = 0;
+
+        for (int block = 0; block < numBlocks; block++) {
+            lfo.process(sinOut, cosOut, blockSize);
+
+            for (int i = 0; i < blockSize; i++) {
+                maxError = jmax(maxError, std::abs(std::sin(MathConstants<double>::twoPi * phase) - sinOut[i]));
+                phase += (double)frequency / sampleRate;
+                phase -= std::floor(phase);
+            }
+        }
+
+        *table << String(config.name).paddedRight(' ', 16) << String(ns, 2).paddedLeft(' ', 8) << " ns/sample   max error "
+                  << String(maxError, 9) << std::endl;
+
+        auto* result = new DynamicObject();
+        result->setProperty("mode", config.name);
+        result->setProperty("nsPerSample", ns);
+        result->setProperty("maxError", maxError);
+        results.add(var(result));
+    }
+
+    return results;
+}
+
+//==============================================================================
+// Size of a saved state and time to save and restore it, binary against the legacy XML
+static var benchmarkState()
+{
+    const int iterations = 10000;
+    ChorusFlangerAudioProcessor processor;
+
+    MemoryBlock binaryState;
+    processor.getStateInformation(binaryState);
+
+    // What getStateInformation wrote before the binary format
+    MemoryBlock xmlState;
+    XmlElement xml("FlangerChorus");
+    xml.setAttribute("DryWet", 0.5);
+    xml.setAttribute("Depth", 0.5);
+    xml.setAttribute("Rate", 10.0);
+    xml.setAttribute("PhaseOffset", 0.0);
+    xml.setAttribute("Feedback", 0.5);
+    xml.setAttribute("Type", 0);
+    xml.setAttribute("Voices", 1);
+    xml.setAttribute("Oversampling", 0);
+    xml.setAttribute("Interpolation", 0);
+    xml.setAttribute("DelayPrecision", 0);
+    AudioProcessor::copyXmlToBinary(xml, xmlState);
+
+    Array<var> results;
+    *table << std::endl << "State (" << iterations << " round trips)" << std::endl;
+
+    auto measure = [&](const char* name, const MemoryBlock& state, bool save) {
+        int64 start = Time::getHighResolutionTicks();
+
+        for (int iteration = 0; iteration < iterations; iteration++) {
+            if (save) {
+                MemoryBlock saved;
+                processor.getStateInformation(saved);
+            }
+
+            processor.setStateInformation(state.getData(), (int)state.getSize());
+        }
+
+        double us = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start) * 1.0e6 / iterations;
+
+        *table << String(name).paddedRight(' ', 16) << String((int)state.getSize()).paddedLeft(' ', 6) << " bytes"
+                  << String(us, 3).paddedLeft(' ', 10) << " us" << std::endl;
+
+        auto* result = new DynamicObject();
+        result->setProperty("format", name);
+        result->setProperty("bytes", (int)state.getSize());
+        result->setProperty("microseconds", us);
+        results.add(var(result));
+    };
+
+    measure("binary", binaryState, true);
+    measure("xml (load only)", xmlState, false);
+
+    return results;
+}
+
+//==============================================================================
+// Time to create, prepare and destroy an instance - the bare engine against the plugin around it
+static var benchmarkInstantiation()
+{
+    const int iterations = 200;
+    const double sampleRate = 48000.0;
+    const int blockSize = 512;
+
+    Array<var> results;
+    *table << std::endl << "Instantiation (stereo, 48 kHz, 512 samples, " << iterations << " instances)" << std::endl;
+
+    auto measure = [&](const char* name, auto instantiate) {
+        int64 start = Time::getHighResolutionTicks();
+
+        for (int iteration = 0; iteration < iterations; iteration++) {
+            instantiate();
+        }
+
+        double us = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start) * 1.0e6 / iterations;
+
+        *table << String(name).paddedRight(' ', 16) << String(us, 3).paddedLeft(' ', 10) << " us" << std::endl;
+
+        auto* result = new DynamicObject();
+        result->setProperty("instance", name);
+        result->setProperty("microseconds", us);
+        results.add(var(result));
+    };
+
+    measure("engine", [&] {
+        ChorusFlangerEngine engine;
+        engine.prepare(sampleRate, blockSize, 2);
+    });
+
+    measure("processor", [&] {
+        ChorusFlangerAudioProcessor processor;
+        processor.setPlayConfigDetails(2, 2, sampleRate, blockSize);
+        processor.prepareToPlay(sampleRate, blockSize);
+    });
+
+    return results;
+}
+
+//==============================================================================
+// Cost of sample-accurate automation - the engine with more and more timestamped changes per block, up to one a sample
+static var benchmarkEvents(double seconds)
+{
+    const int numChannels = 2;
+    const double sampleRate = 48000.0;
+    const int blockSize = 512;
+    const int numBlocks = jmax(64, (int)(seconds * sampleRate / blockSize));
+
+    AudioBuffer<float> input(numChannels, blockSize);
+    AudioBuffer<float> buffer(numChannels, blockSize);
+    Random random(1);
+
+    for (int channel = 0; channel < numChannels; channel++) {
+        for (int i = 0; i < blockSize; i++) {
+            input.setSample(channel, i, random.nextFloat() * 2.0f - 1.0f);
+        }
+    }
+
+    Array<var> results;
+    *table << std::endl << "Parameter events (stereo, 48 kHz, 512 samples)" << std::endl;
+    *table << "events/block   mean ns/smp" << std::endl;
+
+    for (int numEvents : { 0, 1, 8, 64, blockSize }) {
+        ChorusFlangerEngine engine;
+        engine.prepare(sampleRate, blockSize, numChannels);
+
+        // Evenly spaced changes to the continuous parameters, new values every block
+        std::vector<ChorusFlangerParameterEvent> events((size_t)numEvents);
+        const ChorusFlangerParameterID parameters[] = { ChorusFlangerParameterID::depth, ChorusFlangerParameterID::rate,
+                                                        ChorusFlangerParameterID::feedback, ChorusFlangerParameterID::dryWet };
+
+        double totalSeconds = 0.0;
+
+        for (int block = -16; block < numBlocks; block++) { // the first 16 warm up, untimed
+            for (int event = 0; event < numEvents; event++) {
+                auto parameter = parameters[event % 4];
+                float value = random.nextFloat();
+
+                if (parameter == ChorusFlangerParameterID::rate) {
+                    value = 0.1f + 19.9f * value;
+                }
+                else if (parameter == ChorusFlangerParameterID::feedback) {
+                    value *= 0.98f;
+                }
+
+                events[(size_t)event] = { event * blockSize / numEvents, parameter, value };
+            }
+
+            buffer.makeCopyOf(input, true);
+
+            int64 start = Time::getHighResolutionTicks();
+            engine.process(buffer.getArrayOfWritePointers(), numChannels, blockSize, events.data(), numEvents);
+            int64 end = Time::getHighResolutionTicks();
+
+            if (block >= 0) {
+                totalSeconds += Time::highResolutionTicksToSeconds(end - start);
+            }
+        }
+
+        const double ns = totalSeconds * 1.0e9 / ((double)numBlocks * blockSize);
+
+        *table << String(numEvents).paddedLeft(' ', 12) << String(ns, 2).paddedLeft(' ', 14) << std::endl;
+
+        auto* result = new DynamicObject();
+        result->setProperty("eventsPerBlock", numEvents);
+        result->setProperty("meanNsPerSample", ns);
+        results.add(var(result));
+    }
+
+    return results;
+}
+
+//==============================================================================
+// Throughput of a StreamBank against its thread count - every tick due within one block period
+static var benchmarkStreamBank(int numStreams, const StringArray& threadCounts, double seconds)
+{
+    const int numChannels = 2;
+    const double sampleRate = 48000.0;
+    const int blockSize = 256;
+    const double blockSeconds = blockSize / sampleRate;
+    const int numTicks = jmax(10, (int)(seconds / blockSeconds));
+
+    // One buffer per stream, filled with noise once - the bank processes in place, so it runs on its own output
+    AudioBuffer<float> buffer(numStreams * numChannels, blockSize);
+    Random random(1);
+
+    for (int channel = 0; channel < buffer.getNumChannels(); channel++) {
+        for (int i = 0; i < blockSize; i++) {
+            buffer.setSample(channel, i, random.nextFloat() * 2.0f - 1.0f);
+        }
+    }
+
+    std::vector<float* const*> streams((size_t)numStreams);
+
+    for (int stream = 0; stream < numStreams; stream++) {
+        streams[(size_t)stream] = buffer.getArrayOfWritePointers() + stream * numChannels;
+    }
+
+    Array<var> results;
+    double singleThreadMean = 0.0;
+
+    *table << std::endl << "Stream bank (" << numStreams << " streams, stereo, 48 kHz, 256 samples)" << std::endl;
+    *table << "threads   mean us/tick    p99 us/tick   streams/core   scaling   skipped" << std::endl;
+
+    for (auto& value : threadCounts) {
+        StreamBank bank;
+        bank.prepare(numStreams, numChannels, sampleRate, blockSize, value.getIntValue());
+
+        // Every stream different, as a real bank's would be
+        for (int stream = 0; stream < numStreams; stream++) {
+            StreamParameters parameters;
+            parameters.rate = 0.1f + 19.9f * random.nextFloat();
+            parameters.depth = random.nextFloat();
+            parameters.phaseOffset = random.nextFloat();
+            parameters.type = random.nextInt(2);
+            bank.setParameters(stream, parameters);
+        }
+
+        for (int tick = 0; tick < 10; tick++) {
+            bank.process(streams.data(), blockSize); // warm up caches and threads
+        }
+
+        std::vector<double> tickSeconds;
+        int numSkipped = 0;
+
+        for (int tick = 0; tick < numTicks; tick++) {
+            StreamTickStats stats = bank.process(streams.data(), blockSize, blockSeconds);
+            tickSeconds.push_back(stats.seconds);
+            numSkipped += stats.numSkipped;
+        }
+
+        std::sort(tickSeconds.begin(), tickSeconds.end());
+
+        double mean = 0.0;
+
+        for (double tick : tickSeconds) {
+            mean += tick;
+        }
+
+        mean /= numTicks;
+
+        const int numThreads = bank.getNumThreads();
+        const double p99 = tickSeconds[(size_t)((numTicks - 1) * 0.99)];
+        const double streamsPerCore = numStreams * blockSeconds / (p99 * numThreads); // at p99, if ticks were only that busy
+
+        if (singleThreadMean == 0.0 || numThreads == 1) {
+            singleThreadMean = mean * numThreads; // the first count stands in for one thread if 1 was not asked for
+        }
+
+        const double scaling = singleThreadMean / (mean * numThreads); // 1.0 = linear
+
+        *table << String(numThreads).paddedLeft(' ', 7) << String(mean * 1.0e6, 2).paddedLeft(' ', 15)
+                  << String(p99 * 1.0e6, 2).paddedLeft(' ', 15) << String(streamsPerCore, 1).paddedLeft(' ', 15)
+                  << String(scaling, 2).paddedLeft(' ', 10) << String(numSkipped).paddedLeft(' ', 10) << std::endl;
+
+        auto* result = new DynamicObject();
+        result->setProperty("threads", numThreads);
+        result->setProperty("meanUsPerTick", mean * 1.0e6);
+        result->setProperty("p99UsPerTick", p99 * 1.0e6);
+        result->setProperty("streamsPerCore", streamsPerCore);
+        result->setProperty("scaling", scaling);
+        result->setProperty("skippedStreams", numSkipped);
+        results.add(var(result));
+    }
+
+    return results;
+}
+
+//==============================================================================
+static StringArray getListOption(const ArgumentList& args, const String& option, const String& defaultValue)
+{
+    String value = args.containsOption(option) ? args.getValueForOption(option) : defaultValue;
+    return StringArray::fromTokens(value, ",", "");
+}
+
+// Replaces each config with one copy per listed value, so the list ends up holding every combination
+template <typename Setter>
+static void expandConfigs(std::vector<BenchmarkConfig>& configs, const StringArray& values, Setter setValue)
+{
+    std::vector<BenchmarkConfig> expanded;
+
+    for (auto& config : configs) {
+        for (auto& value : values) {
+            BenchmarkConfig copy = config;
+            setValue(copy, value);
+            expanded.push_back(copy);
+        }
+    }
+
+    configs.swap(expanded);
+}
+
+int main (int argc, char* argv[])
+{
+    ScopedJuceInitialiser_GUI juceInitialiser; // the processor publishes preset changes through the message thread
+
+    ArgumentList args(argc, argv);
+
+    double seconds = args.containsOption("--seconds") ? args.getValueForOption("--seconds").getDoubleValue() : 0.5;
+    double deadlineFraction = args.containsOption("--deadline") ? args.getValueForOption("--deadline").getDoubleValue() : 1.0;
+    String label = args.getValueForOption("--label");
+    String jsonPath = args.getValueForOption("--json");
+
+    if (jsonPath == "-") {
+        table = &std::cerr;
+    }
+
+    String tracePath = args.getValueForOption("--trace");
+    int bankStreams = args.containsOption("--bank-streams") ? args.getValueForOption("--bank-streams").getIntValue() : 256;
+
+    // Powers of two up to the core count, and the core count itself
+    String bankThreads;
+
+    for (int numThreads = 1; numThreads < SystemStats::getNumCpus(); numThreads *= 2) {
+        bankThreads << numThreads << ",";
+    }
+
+    bankThreads << SystemStats::getNumCpus();
+
+    // The matrix, outermost option first
+    std::vector<BenchmarkConfig> configs(1);
+
+    expandConfigs(configs, getListOption(args, "--channels", "2"), [](BenchmarkConfig& c, const String& v) { c.numChannels = v.getIntValue(); });
+    expandConfigs(configs, getListOption(args, "--rates", "44100,48000,88200,96000,192000,384000"), [](BenchmarkConfig& c, const String& v) { c.sampleRate = v.getDoubleValue(); });
+    expandConfigs(configs, getListOption(args, "--blocks", "1,16,64,256,512,2048,8192"), [](BenchmarkConfig& c, const String& v) { c.blockSize = v.getIntValue(); });
+    expandConfigs(configs, getListOption(args, "--types", "chorus,flanger"), [](BenchmarkConfig& c, const String& v) { c.type = (v == "flanger") ? 1 : 0; });
+    expandConfigs(configs, getListOption(args, "--voices", "1"), [](BenchmarkConfig& c, const String& v) { c.numVoices = v.getIntValue(); });
+    expandConfigs(configs, getListOption(args, "--oversampling", "1"), [](BenchmarkConfig& c, const String& v) { c.oversamplingFactor = v.getIntValue(); });
+    expandConfigs(configs, getListOption(args, "--interpolation", "linear"), [](BenchmarkConfig& c, const String& v) { c.interpolation = jmax(0, interpolationNames.indexOf(v)); });
+    expandConfigs(configs, getListOption(args, "--automation", "static,sweep,storm"), [](BenchmarkConfig& c, const String& v) { c.automation = v; });
+    expandConfigs(configs, getListOption(args, "--input", "noise"), [](BenchmarkConfig& c, const String& v) { c.input = v; });
+    expandConfigs(configs, getListOption(args, "--precision", "float"), [](BenchmarkConfig& c, const String& v) { c.doublePrecision = (v == "double"); });
+    expandConfigs(configs, getListOption(args, "--storage", "32"), [](BenchmarkConfig& c, const String& v) { c.delayPrecision = (v == "64") ? 1 : (v == "16") ? 2 : 0; });
+    expandConfigs(configs, getListOption(args, "--bypass", "off"), [](BenchmarkConfig& c, const String& v) { c.bypass = v; });
+
+    *table << "  ch    rate  block     type voices  os    interp  automation   input    host  delay  bypass   mean ns/smp    p99 ns/smp    max ns/smp   inst/core" << std::endl;
+
+    Array<var> results;
+
+    for (auto& config : configs) {
+        BenchmarkResult result = config.doublePrecision ? runBenchmark<double>(config, seconds, deadlineFraction, tracePath)
+                                                        : runBenchmark<float>(config, seconds, deadlineFraction, tracePath);
+        tracePath = {}; // the first configuration only
+        String type = (config.type == 1) ? "flanger" : "chorus";
+
+        *table << String(config.numChannels).paddedLeft(' ', 4) << String((int)config.sampleRate).paddedLeft(' ', 8)
+                  << String(config.blockSize).paddedLeft(' ', 7) << type.paddedLeft(' ', 9)
+                  << String(config.numVoices).paddedLeft(' ', 7) << (String(config.oversamplingFactor) + "x").paddedLeft(' ', 4)
+                  << interpolationNames[config.interpolation].paddedLeft(' ', 10)
+                  << config.automation.paddedLeft(' ', 12)
+                  << config.input.paddedLeft(' ', 8)
+                  << String(config.doublePrecision ? "double" : "float").paddedLeft(' ', 8)
+                  << String(storageBits[config.delayPrecision]).paddedLeft(' ', 7)
+                  << config.bypass.paddedLeft(' ', 8)
+                  << String(result.meanNsPerSample, 2).paddedLeft(' ', 14)
+                  << String(result.p99NsPerSample, 2).paddedLeft(' ', 14)
+                  << String(result.maxNsPerSample, 2).paddedLeft(' ', 14)
+                  << String(result.instancesPerCore, 1).paddedLeft(' ', 12) << std::endl;
+
+       #if CHORUSFLANGER_PROFILING
+        for (auto& stage : *result.stages.getArray()) {
+            *table << "      " << stage["stage"].toString().paddedRight(' ', 14)
+                      << "p50 " << String((double)stage["p50Us"], 2).paddedLeft(' ', 9) << " us"
+                      << "   p99 " << String((double)stage["p99Us"], 2).paddedLeft(' ', 9) << " us"
+                      << "   max " << String((double)stage["maxUs"], 2).paddedLeft(' ', 9) << " us" << std::endl;
+        }
+       #endif
+
+        auto* entry = new DynamicObject();
+        entry->setProperty("channels", config.numChannels);
+        entry->setProperty("sampleRate", config.sampleRate);
+        entry->setProperty("blockSize", config.blockSize);
+        entry->setProperty("type", type);
+        entry->setProperty("voices", config.numVoices);
+        entry->setProperty("oversampling", config.oversamplingFactor);
+        entry->setProperty("interpolation", interpolationNames[config.interpolation]);
+        entry->setProperty("automation", config.automation);
+        entry->setProperty("input", config.input);
+        entry->setProperty("precision", config.doublePrecision ? "double" : "float");
+        entry->setProperty("delayStorageBits", storageBits[config.delayPrecision]);
+        entry->setProperty("bypass", config.bypass);
+        entry->setProperty("meanNsPerSample", result.meanNsPerSample);
+        entry->setProperty("p99NsPerSample", result.p99NsPerSample);
+        entry->setProperty("maxNsPerSample", result.maxNsPerSample);
+        entry->setProperty("instancesPerCore", result.instancesPerCore);
+
+        if (! result.stages.isVoid()) {
+            entry->setProperty("stages", result.stages);
+        }
+        results.add(var(entry));
+    }
+
+    var lfoResults = benchmarkLFOs();
+    var stateResults = benchmarkState();
+    var instantiationResults = benchmarkInstantiation();
+    var eventResults = benchmarkEvents(seconds);
+    var bankResults = (bankStreams > 0) ? benchmarkStreamBank(bankStreams, getListOption(args, "--bank-threads", bankThreads), seconds) : var();
+
+    if (jsonPath.isNotEmpty()) {
+        auto* root = new DynamicObject();
+        var rootVar(root);
+
+        root->setProperty("label", label);
+        root->setProperty("seconds", seconds);
+        root->setProperty("deadlineFraction", deadlineFraction);
+        root->setProperty("results", results);
+        root->setProperty("lfo", lfoResults);
+        root->setProperty("state", stateResults);
+        root->setProperty("instantiation", instantiationResults);
+        root->setProperty("events", eventResults);
+
+        if (! bankResults.isVoid()) {
+            root->setProperty("streamBank", bankResults);
+        }
+
+        String json = JSON::toString(rootVar);
+
+        if (jsonPath == "-") {
+            std::cout << json << std::endl;
+        }
+        else if (! File::getCurrentWorkingDirectory().getChildFile(jsonPath).replaceWithText(json)) {
+            std::cerr << "Could not write " << jsonPath << std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,623 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Headless offline renderer - runs ChorusFlangerAudioProcessor over audio files.
+
+    Inputs are WAV or AIFF files, or folders searched for them. Each is read through a
+    memory-mapped reader, processed in large blocks and streamed to a file of the same name
+    and format in the output folder. A thread pool renders many files at once, each worker
+    with its own engine, and the run reports its throughput as a multiple of realtime.
+
+    With --chunk, every file is split into chunks of that many seconds instead, rendered side by
+    side and written in order. Each chunk's engine seeks to the chunk's start and is primed with
+    the input before it (--prime, by default the effect's tail length), so the output matches a
+    render in one piece to within the silence threshold (1e-5) once the feedback tail fits in the
+    prime - a chorus at 0.98 feedback needs about 17 s of it. With 16-bit delay storage a sample
+    can still land a step of that storage (1.2e-4) away, where what is left of the tail tips it
+    over a rounding boundary.
+
+    Usage:
+      ChorusFlangerRender <files or folders>... --output=<folder>
+                          [--state=<file>] [--preset=<index or name>]
+                          [--drywet=0.5] [--depth=0.5] [--rate=10] [--phaseoffset=0] [--feedback=0.5]
+                          [--type=chorus|flanger] [--voices=1] [--oversampling=1|2|4]
+                          [--interpolation=linear|hermite|lagrange|thiran] [--storage=32|64|16]
+                          [--tail] [--bits=16|24|32] [--block=8192] [--threads=<all cores>] [--overwrite]
+                          [--chunk=<seconds>] [--prime=<seconds>]
+
+    --state loads a state blob saved by the plugin (either format), --preset a factory preset,
+    and the parameter options then override single values - applied in that order.
+    --tail renders the effect tail after the end of the input, otherwise the output is as long as the
+    input. Oversampling latency is compensated either way.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../Source/PluginProcessor.h"
+
+// Samples read, processed and written per step - large, so the file I/O runs in long sequential runs
+# define RENDER_BLOCK_SIZE 8192
+
+// Output file buffer (bytes)
+# define RENDER_WRITE_BUFFER_SIZE (1 << 20)
+
+// How often the progress line is updated (ms)
+# define RENDER_PROGRESS_INTERVAL 1000
+
+// Interpolator names, in parameter order
+static const StringArray interpolationNames { "linear", "hermite", "lagrange", "thiran" };
+
+//==============================================================================
+// Everything the workers share - read-only once the run starts, apart from the counters
+struct RenderSettings
+{
+    MemoryBlock state; // engine settings, as a plugin state blob
+    File outputFolder;
+    int blockSize;
+    int bitsPerSample; // 0 = same as the input
+    bool renderTail;
+    bool overwrite;
+    double chunkSeconds; // 0 = every file in one piece
+    double primeSeconds; // -1 = the tail length
+};
+
+// A file being rendered in chunks - the chunks are taken in order, and each one waits for the one before it to
+// be written before writing itself, so the output streams out in order
+struct ChunkedFile
+{
+    File inputFile;
+    double sampleRate = 0;
+    int64 inputLength = 0; // in samples
+    int64 length = 0; // input plus tail
+    int64 latency = 0;
+    int64 chunkLength = 0; // whole blocks
+    int64 primeLength = 0; // whole blocks
+    int numChunks = 1;
+
+    std::unique_ptr<AudioFormatWriter> writer; // opened by the first chunk, closed by the last
+    std::atomic<int> nextToWrite { 0 };
+    std::atomic<bool> failed { false };
+};
+
+// A chunk of the run - the run's chunks are listed file by file, in order
+struct RenderChunk
+{
+    int file;
+    int chunk;
+};
+
+struct RenderTotals
+{
+    std::atomic<int> nextFile { 0 };
+    std::atomic<int> nextChunk { 0 }; // index into the run's list of chunks
+    std::atomic<int> numDone { 0 };
+    std::atomic<int> numFailed { 0 };
+    std::atomic<double> secondsRendered { 0 }; // length of the inputs, in seconds of audio
+};
+
+//==============================================================================
+static AudioProcessorParameterWithID* findParameter(AudioProcessor& processor, const String& parameterID)
+{
+    for (auto* parameter : processor.getParameters()) {
+        auto* parameterWithID = (AudioProcessorParameterWithID*)parameter;
+
+        if (parameterWithID->paramID == parameterID) {
+            return parameterWithID;
+        }
+    }
+
+    return nullptr;
+}
+
+static void setPlainValue(AudioProcessor& processor, const String& parameterID, float value)
+{
+    auto* parameter = (RangedAudioParameter*)findParameter(processor, parameterID);
+    jassert(parameter != nullptr);
+
+    parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+}
+
+// The engine settings from the command line, in the order they override each other
+static bool buildState(const ArgumentList& args, MemoryBlock& state)
+{
+    ChorusFlangerAudioProcessor processor;
+
+    if (args.containsOption("--state")) {
+        MemoryBlock savedState;
+        File stateFile = args.getExistingFileForOption("--state");
+
+        if (! stateFile.loadFileAsData(savedState)) {
+            std::cerr << "Could not read " << stateFile.getFullPathName() << std::endl;
+            return false;
+        }
+
+        processor.setStateInformation(savedState.getData(), (int)savedState.getSize());
+    }
+
+    if (args.containsOption("--preset")) {
+        String name = args.getValueForOption("--preset");
+        int index = name.containsOnly("0123456789") ? name.getIntValue() : -1;
+
+        for (int program = 0; program < NUM_FACTORY_PRESETS && index < 0; program++) {
+            if (name.equalsIgnoreCase(getFactoryPreset(program).name)) {
+                index = program;
+            }
+        }
+
+        if (index < 0 || index >= NUM_FACTORY_PRESETS) {
+            std::cerr << "Unknown preset " << name << std::endl;
+            return false;
+        }
+
+        const Preset& preset = getFactoryPreset(index);
+
+        setPlainValue(processor, "drywet", preset.dryWet);
+        setPlainValue(processor, "depth", preset.depth);
+        setPlainValue(processor, "rate", preset.rate);
+        setPlainValue(processor, "phaseoffset", preset.phaseOffset);
+        setPlainValue(processor, "feedback", preset.feedback);
+        setPlainValue(processor, "type", (float)preset.type);
+        setPlainValue(processor, "voices", (float)preset.voices);
+    }
+
+    // Continuous parameters take their plain values, the rest take the names the benchmark uses
+    for (auto parameterID : { "drywet", "depth", "rate", "phaseoffset", "feedback", "voices" }) {
+        if (args.containsOption("--" + String(parameterID))) {
+            setPlainValue(processor, parameterID, args.getValueForOption("--" + String(parameterID)).getFloatValue());
+        }
+    }
+
+    if (args.containsOption("--type")) {
+        setPlainValue(processor, "type", (args.getValueForOption("--type") == "flanger") ? 1.0f : 0.0f);
+    }
+
+    if (args.containsOption("--oversampling")) {
+        int factor = args.getValueForOption("--oversampling").getIntValue();
+        setPlainValue(processor, "oversampling", (float)jlimit(0, MAX_OVERSAMPLING_ORDER, roundToInt(std::log2(jmax(1, factor)))));
+    }
+
+    if (args.containsOption("--interpolation")) {
+        setPlainValue(processor, "interpolation", (float)jmax(0, interpolationNames.indexOf(args.getValueForOption("--interpolation"))));
+    }
+
+    if (args.containsOption("--storage")) {
+        String storage = args.getValueForOption("--storage");
+        setPlainValue(processor, "delayprecision", (storage == "64") ? 1.0f : (storage == "16") ? 2.0f : 0.0f);
+    }
+
+    processor.getStateInformation(state);
+    return true;
+}
+
+// Every WAV and AIFF file named on the command line or found under a folder named there, largest first
+static Array<File> findInputFiles(const ArgumentList& args)
+{
+    const String pattern = "*.wav;*.aif;*.aiff";
+    Array<File> files;
+
+    for (auto& argument : args.arguments) {
+        if (argument.isOption()) {
+            continue;
+        }
+
+        File file = argument.resolveAsFile();
+
+        if (file.isDirectory()) {
+            files.addArray(file.findChildFiles(File::findFiles, true, pattern));
+        }
+        else if (file.existsAsFile()) {
+            files.add(file);
+        }
+        else {
+            std::cerr << "Not found: " << argument.text << std::endl;
+        }
+    }
+
+    // Starting the long files first keeps one from finishing alone at the end of the batch
+    std::sort(files.begin(), files.end(), [](const File& a, const File& b) { return a.getSize() > b.getSize(); });
+
+    return files;
+}
+
+//==============================================================================
+// Memory-mapped when the format allows it, so reading is a copy out of the page cache
+static AudioFormatReader* createReader(AudioFormatManager& formatManager, const File& file)
+{
+    AudioFormat* format = formatManager.findFormatForFileExtension(file.getFileExtension());
+
+    if (format == nullptr) {
+        return nullptr;
+    }
+
+    std::unique_ptr<MemoryMappedAudioFormatReader> mappedReader(format->createMemoryMappedReader(file));
+
+    if (mappedReader != nullptr && mappedReader->mapEntireFile()) {
+        return mappedReader.release();
+    }
+
+    return formatManager.createReaderFor(file);
+}
+
+// Streams to a file of the same name and format in the output folder - returns an error message, or nothing
+static String createWriter(AudioFormatManager& formatManager, const File& inputFile, AudioFormatReader& reader,
+                           const RenderSettings& settings, std::unique_ptr<AudioFormatWriter>& writer)
+{
+    AudioFormat* format = formatManager.findFormatForFileExtension(inputFile.getFileExtension());
+    File outputFile = settings.outputFolder.getChildFile(inputFile.getFileName());
+
+    if (outputFile == inputFile || (outputFile.exists() && ! settings.overwrite)) {
+        return "output " + outputFile.getFullPathName() + " exists";
+    }
+
+    const int bitsPerSample = (settings.bitsPerSample > 0) ? settings.bitsPerSample : (int)reader.bitsPerSample;
+
+    outputFile.deleteFile();
+    auto stream = std::make_unique<FileOutputStream>(outputFile, RENDER_WRITE_BUFFER_SIZE);
+
+    if (! stream->openedOk()) {
+        return "could not create " + outputFile.getFullPathName();
+    }
+
+    writer.reset(format->createWriterFor(stream.get(), reader.sampleRate, reader.numChannels, bitsPerSample,
+                                         reader.metadataValues, 0));
+
+    if (writer == nullptr) {
+        return "could not write " + String(bitsPerSample) + " bit " + format->getFormatName();
+    }
+
+    stream.release(); // the writer owns it now
+    return {};
+}
+
+// Prepares the engine for a file - the same settings every time, then a fresh start
+static void prepareEngine(ChorusFlangerAudioProcessor& processor, const RenderSettings& settings, int numChannels, double sampleRate)
+{
+    processor.setPlayConfigDetails(numChannels, numChannels, sampleRate, settings.blockSize);
+    processor.setStateInformation(settings.state.getData(), (int)settings.state.getSize());
+    processor.prepareToPlay(sampleRate, settings.blockSize);
+}
+
+static void addSecondsRendered(RenderTotals& totals, double seconds)
+{
+    double secondsRendered = totals.secondsRendered.load();
+
+    while (! totals.secondsRendered.compare_exchange_weak(secondsRendered, secondsRendered + seconds)) {}
+}
+
+//==============================================================================
+/**
+    One pool thread's share of the batch.
+
+    Owns an engine and a set of buffers, and takes files off the shared list until it is empty - the engine is
+    prepared again for each file, so nothing but the parameters carries over from one to the next. In chunked
+    runs it takes chunks off the list of every file's chunks instead, and prepares the engine for each chunk.
+*/
+class RenderWorker : public ThreadPoolJob
+{
+public:
+    RenderWorker(const Array<File>& files, OwnedArray<ChunkedFile>& chunkedFiles, const Array<RenderChunk>& chunks,
+                 const RenderSettings& settings, RenderTotals& totals)
+        : ThreadPoolJob("Render worker"), mFiles(files), mChunkedFiles(chunkedFiles), mChunks(chunks), mSettings(settings),
+          mTotals(totals)
+    {
+        mFormatManager.registerBasicFormats();
+    }
+
+    JobStatus runJob() override
+    {
+        if (mSettings.chunkSeconds > 0) {
+            for (int index = mTotals.nextChunk++; index < mChunks.size() && ! shouldExit(); index = mTotals.nextChunk++) {
+                renderChunk(*mChunkedFiles[mChunks.getReference(index).file], mChunks.getReference(index).chunk);
+            }
+
+            return jobHasFinished;
+        }
+
+        for (int index = mTotals.nextFile++; index < mFiles.size() && ! shouldExit(); index = mTotals.nextFile++) {
+            String error = renderFile(mFiles.getReference(index));
+
+            if (error.isNotEmpty()) {
+                std::cerr << mFiles.getReference(index).getFullPathName() << ": " << error << std::endl;
+                mTotals.numFailed++;
+            }
+
+            mTotals.numDone++;
+        }
+
+        return jobHasFinished;
+    }
+
+private:
+    // Returns an error message, or nothing once the file is written
+    String renderFile(const File& inputFile)
+    {
+        std::unique_ptr<AudioFormatReader> reader(createReader(mFormatManager, inputFile));
+
+        if (reader == nullptr) {
+            return "could not open";
+        }
+
+        const int numChannels = (int)reader->numChannels;
+        const double sampleRate = reader->sampleRate;
+
+        if (numChannels < 1 || numChannels > MAX_CHANNELS) {
+            return "unsupported channel count " + String(numChannels);
+        }
+
+        const int blockSize = mSettings.blockSize;
+        prepareEngine(mProcessor, mSettings, numChannels, sampleRate);
+
+        // The first latency samples out are only the filters filling, so they are dropped, and the input is
+        // followed by as much silence to get its end back out
+        const int64 latency = mProcessor.getLatencySamples();
+        const int64 tailLength = mSettings.renderTail ? (int64)std::ceil(mProcessor.getTailLengthSeconds() * sampleRate) : latency;
+        const int64 inputLength = reader->lengthInSamples;
+
+        std::unique_ptr<AudioFormatWriter> writer;
+        String error = createWriter(mFormatManager, inputFile, *reader, mSettings, writer);
+
+        if (error.isNotEmpty()) {
+            return error;
+        }
+
+        mBuffer.setSize(numChannels, blockSize, false, false, true);
+        MidiBuffer midi;
+
+        for (int64 position = 0; position < inputLength + tailLength && ! shouldExit(); position += blockSize) {
+            const int numSamples = (int)jmin((int64)blockSize, inputLength + tailLength - position);
+
+            // Past the end of the input the reader fills in silence
+            mBuffer.setSize(numChannels, numSamples, true, false, true);
+            reader->read(&mBuffer, 0, numSamples, position, true, true);
+
+            mProcessor.processBlock(mBuffer, midi);
+
+            // Drop what falls in the latency, write the rest
+            const int64 skip = jlimit((int64)0, (int64)numSamples, latency - position);
+
+            if (skip < numSamples && ! writer->writeFromAudioSampleBuffer(mBuffer, (int)skip, numSamples - (int)skip)) {
+                return "write failed";
+            }
+        }
+
+        mProcessor.releaseResources();
+        addSecondsRendered(mTotals, (double)inputLength / sampleRate);
+
+        return {};
+    }
+
+    // Renders one chunk into memory, waits for the chunks before it to be written, then writes it. A chunk always
+    // takes its turn, even when the file has failed, so the chunks after it don't wait forever.
+    void renderChunk(ChunkedFile& file, int chunk)
+    {
+        String error = file.failed ? String() : renderChunkAudio(file, chunk);
+
+        while (file.nextToWrite.load() != chunk) {
+            Thread::sleep(1);
+        }
+
+        if (error.isEmpty() && ! file.failed && chunk == 0) {
+            error = createWriter(mFormatManager, file.inputFile, *mReader, mSettings, file.writer);
+        }
+
+        if (error.isEmpty() && ! file.failed) {
+            // Drop what falls in the latency, write the rest
+            const int64 start = chunk * file.chunkLength;
+            const int skip = (int)jlimit((int64)0, (int64)mBuffer.getNumSamples(), file.latency - start);
+
+            if (skip < mBuffer.getNumSamples() && ! file.writer->writeFromAudioSampleBuffer(mBuffer, skip, mBuffer.getNumSamples() - skip)) {
+                error = "write failed";
+            }
+        }
+
+        if (error.isNotEmpty() && ! file.failed.exchange(true)) {
+            std::cerr << file.inputFile.getFullPathName() << ": " << error << std::endl;
+        }
+
+        // The last chunk closes the file
+        if (chunk == file.numChunks - 1) {
+            file.writer.reset();
+
+            if (file.failed) {
+                mTotals.numFailed++;
+            }
+            else {
+                addSecondsRendered(mTotals, (double)file.inputLength / file.sampleRate);
+            }
+
+            mTotals.numDone++;
+        }
+
+        file.nextToWrite++;
+    }
+
+    // Primes the engine with the input before the chunk, then renders the chunk into mBuffer
+    String renderChunkAudio(ChunkedFile& file, int chunk)
+    {
+        // One reader per worker per file - a reader is not shared between threads
+        if (mReader == nullptr || mReaderFile != file.inputFile) {
+            mReader.reset(createReader(mFormatManager, file.inputFile));
+            mReaderFile = file.inputFile;
+        }
+
+        if (mReader == nullptr) {
+            return "could not open";
+        }
+
+        const int numChannels = (int)mReader->numChannels;
+
+        if (numChannels < 1 || numChannels > MAX_CHANNELS) {
+            return "unsupported channel count " + String(numChannels);
+        }
+
+        prepareEngine(mProcessor, mSettings, numChannels, mReader->sampleRate);
+
+        // Chunks and the prime are whole blocks, so the blocks fall where they would in one piece
+        const int64 start = chunk * file.chunkLength;
+        const int64 end = jmin(start + file.chunkLength, file.length);
+        const int64 primeStart = jmax((int64)0, start - file.primeLength);
+
+        mHistory.setSize(numChannels, (int)(start - primeStart), false, false, true);
+        mReader->read(&mHistory, 0, mHistory.getNumSamples(), primeStart, true, true);
+        mProcessor.prime(mHistory, start);
+
+        mBuffer.setSize(numChannels, (int)(end - start), false, false, true);
+        MidiBuffer midi;
+
+        for (int64 position = start; position < end && ! shouldExit(); position += mSettings.blockSize) {
+            const int offset = (int)(position - start);
+            const int numSamples = (int)jmin((int64)mSettings.blockSize, end - position);
+
+            // Past the end of the input the reader fills in silence
+            AudioBuffer<float> block(mBuffer.getArrayOfWritePointers(), numChannels, offset, numSamples);
+            mReader->read(&block, 0, numSamples, position, true, true);
+
+            mProcessor.processBlock(block, midi);
+        }
+
+        mProcessor.releaseResources();
+        return {};
+    }
+
+    const Array<File>& mFiles;
+    OwnedArray<ChunkedFile>& mChunkedFiles;
+    const Array<RenderChunk>& mChunks;
+    const RenderSettings& mSettings;
+    RenderTotals& mTotals;
+
+    AudioFormatManager mFormatManager;
+    ChorusFlangerAudioProcessor mProcessor;
+    AudioBuffer<float> mBuffer;
+
+    /* Chunked runs */
+    std::unique_ptr<AudioFormatReader> mReader; // for the file of the last chunk taken
+    File mReaderFile;
+    AudioBuffer<float> mHistory; // the input the engine is primed with
+};
+
+// Splits every file into chunks, from its length and the engine's latency and tail at its rate. Files that
+// can't be read get one chunk, which reports why when it is rendered.
+static void planChunks(const Array<File>& files, const RenderSettings& settings, OwnedArray<ChunkedFile>& chunkedFiles,
+                       Array<RenderChunk>& chunks)
+{
+    AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+    ChorusFlangerAudioProcessor processor;
+
+    for (int index = 0; index < files.size(); index++) {
+        auto* file = chunkedFiles.add(new ChunkedFile());
+        file->inputFile = files.getReference(index);
+
+        std::unique_ptr<AudioFormatReader> reader(createReader(formatManager, file->inputFile));
+
+        if (reader != nullptr && reader->numChannels >= 1 && reader->numChannels <= MAX_CHANNELS) {
+            const double sampleRate = reader->sampleRate;
+            const int64 blockSize = settings.blockSize;
+            prepareEngine(processor, settings, (int)reader->numChannels, sampleRate);
+
+            const double tailSeconds = processor.getTailLengthSeconds();
+            const double primeSeconds = (settings.primeSeconds >= 0) ? settings.primeSeconds : tailSeconds;
+
+            file->sampleRate = sampleRate;
+            file->inputLength = reader->lengthInSamples;
+            file->latency = processor.getLatencySamples();
+            file->length = file->inputLength + (settings.renderTail ? (int64)std::ceil(tailSeconds * sampleRate) : file->latency);
+            file->chunkLength = jmax((int64)1, (int64)std::ceil(settings.chunkSeconds * sampleRate / blockSize)) * blockSize;
+            file->primeLength = (int64)std::ceil(primeSeconds * sampleRate / blockSize) * blockSize;
+            file->numChunks = (int)jmax((int64)1, (file->length + file->chunkLength - 1) / file->chunkLength);
+
+            processor.releaseResources();
+        }
+
+        for (int chunk = 0; chunk < file->numChunks; chunk++) {
+            chunks.add({ index, chunk });
+        }
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    ScopedJuceInitialiser_GUI juceInitialiser; // the processor publishes preset changes through the message thread
+
+    ArgumentList args(argc, argv);
+
+    if (! args.containsOption("--output")) {
+        std::cerr << "Usage: ChorusFlangerRender <files or folders>... --output=<folder> [options] (see Main.cpp)" << std::endl;
+        return 1;
+    }
+
+    RenderSettings settings;
+    settings.outputFolder = args.getFileForOption("--output");
+    settings.blockSize = args.containsOption("--block") ? jmax(1, args.getValueForOption("--block").getIntValue()) : RENDER_BLOCK_SIZE;
+    settings.bitsPerSample = args.getValueForOption("--bits").getIntValue();
+    settings.renderTail = args.containsOption("--tail");
+    settings.overwrite = args.containsOption("--overwrite");
+    settings.chunkSeconds = jmax(0.0, args.getValueForOption("--chunk").getDoubleValue());
+    settings.primeSeconds = args.containsOption("--prime") ? jmax(0.0, args.getValueForOption("--prime").getDoubleValue()) : -1.0;
+
+    if (! settings.outputFolder.createDirectory()) {
+        std::cerr << "Could not create " << settings.outputFolder.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    if (! buildState(args, settings.state)) {
+        return 1;
+    }
+
+    Array<File> files = findInputFiles(args);
+
+    if (files.isEmpty()) {
+        std::cerr << "No input files" << std::endl;
+        return 1;
+    }
+
+    OwnedArray<ChunkedFile> chunkedFiles;
+    Array<RenderChunk> chunks;
+
+    if (settings.chunkSeconds > 0) {
+        planChunks(files, settings, chunkedFiles, chunks);
+    }
+
+    const int numJobs = (settings.chunkSeconds > 0) ? chunks.size() : files.size();
+    const int numThreads = jlimit(1, numJobs, args.containsOption("--threads") ? args.getValueForOption("--threads").getIntValue()
+                                                                               : SystemStats::getNumCpus());
+
+    std::cout << "Rendering " << files.size() << " files";
+
+    if (settings.chunkSeconds > 0) {
+        std::cout << " in " << chunks.size() << " chunks";
+    }
+
+    std::cout << " on " << numThreads << " threads" << std::endl;
+
+    // One worker per thread - each keeps its engine for the whole batch
+    RenderTotals totals;
+    ThreadPool pool(numThreads);
+    int64 start = Time::getHighResolutionTicks();
+
+    for (int worker = 0; worker < numThreads; worker++) {
+        pool.addJob(new RenderWorker(files, chunkedFiles, chunks, settings, totals), true);
+    }
+
+    while (pool.getNumJobs() > 0) {
+        Thread::sleep(RENDER_PROGRESS_INTERVAL);
+        std::cout << "\r" << totals.numDone.load() << " / " << files.size() << std::flush;
+    }
+
+    const double seconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start);
+    const double audioSeconds = totals.secondsRendered.load();
+
+    std::cout << "\r" << totals.numDone.load() - totals.numFailed.load() << " files, " << String(audioSeconds, 1) << " s of audio in "
+              << String(seconds, 2) << " s - " << String(audioSeconds / seconds, 1) << "x realtime ("
+              << String(audioSeconds / seconds / numThreads, 1) << "x per thread)" << std::endl;
+
+    if (totals.numFailed > 0) {
+        std::cerr << totals.numFailed.load() << " files failed" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,1399 @@
+/*
+  ==============================================================================
+
+    ChorusFlangerEngine.cpp
+    The chorus/flanger DSP on its own - no AudioProcessor, parameters, presets or editor.
+
+  ==============================================================================
+*/
+
+#include "ChorusFlangerEngine.h"
+
+//==============================================================================
+// jlimit, except NaN goes to the bottom of the range rather than through
+template <typename Type>
+static Type limitParameter(Type lower, Type upper, Type value)
+{
+    return (value >= lower) ? jmin(upper, value) : lower;
+}
+
+ChorusFlangerParameters ChorusFlangerParameters::limited() const
+{
+    ChorusFlangerParameters parameters;
+    parameters.dryWet = limitParameter(0.0f, 1.0f, dryWet);
+    parameters.depth = limitParameter(0.0f, 1.0f, depth);
+    parameters.rate = limitParameter(MIN_RATE, MAX_RATE, rate);
+    parameters.phaseOffset = limitParameter(0.0f, 1.0f, phaseOffset);
+    parameters.feedback = limitParameter(0.0f, MAX_FEEDBACK, feedback);
+    parameters.type = jlimit(0, 1, type);
+    parameters.voices = jlimit(1, MAX_VOICES, voices);
+    parameters.oversampling = jlimit(0, MAX_OVERSAMPLING_ORDER, oversampling);
+    parameters.interpolation = jlimit(0, NUM_INTERPOLATORS - 1, interpolation);
+    parameters.delayPrecision = jlimit(0, NUM_DELAY_PRECISIONS - 1, delayPrecision);
+
+    return parameters;
+}
+
+bool ChorusFlangerParameters::operator== (const ChorusFlangerParameters& other) const
+{
+    return dryWet == other.dryWet && depth == other.depth && rate == other.rate && phaseOffset == other.phaseOffset
+        && feedback == other.feedback && type == other.type && voices == other.voices && oversampling == other.oversampling
+        && interpolation == other.interpolation && delayPrecision == other.delayPrecision;
+}
+
+//==============================================================================
+ChorusFlangerEngine::ChorusFlangerEngine()
+{
+    // Initialize data to default values
+    mNumChannels = 0;
+
+    mFloatState.clearCore();
+    mDoubleState.clearCore();
+
+    for (int tap = 0; tap < MAX_CHANNELS * MAX_VOICES; tap++) {
+        mPhaseOffsetCos[tap] = 1;
+        mPhaseOffsetSin[tap] = 0;
+        mVoiceCentre[tap] = 0;
+        mVoiceSweep[tap] = 1;
+    }
+
+    mVoiceGain = 1;
+    mInterpolation = 0;
+
+    mDelayPrecision = 0;
+    mVoiceLayoutVoices = 0;
+    mVoiceLayoutType = -1;
+
+    mLFOMode = LFO::Mode::quadrature;
+    mLFOControlRateInterval = 1;
+
+    mSamplePosition = 0;
+    mLFOAnchorPosition = 0;
+    mLFOAnchorPhase = 0;
+    mLFOAnchorRate = -1;
+
+    mPhaseOffsetRotated = -1; // forces the rotations to be worked out on the first tile
+
+    mTileSize = 1;
+
+    mType = 0;
+    mNumVoices = 1;
+    mSampleRate = 44100.0;
+    mCoreSampleRate = 44100.0;
+    mMaximumBlockSize = 0;
+    mDoublePrecision = false;
+
+    mOversamplingOrder = 0;
+    mDryLatency = 0;
+
+    mSleeping = false;
+    mQuietSamples = 0;
+    mSleepAfterSamples = 0;
+    mWetPeak = 0;
+
+    mPresetDuck.setCurrentAndTargetValue(1.0f);
+
+    mBypassMode = BypassMode::keepFed;
+    mBypassFade.setCurrentAndTargetValue(1.0f);
+    mBypassed = false;
+    mBypassRefillSamples = 0;
+}
+
+//==============================================================================
+void ChorusFlangerEngine::prepare(double sampleRate, int maximumBlockSize, int numChannels, bool doublePrecision)
+{
+    // Initialize data for the current sample rate, and reset things such as phase and writeheads
+    mSampleRate = sampleRate;
+    mMaximumBlockSize = maximumBlockSize;
+    mDoublePrecision = doublePrecision;
+
+    // Dry/wet and the fades are always applied at the host rate - the rest are set to the core rate in prepareCore
+    mDryWetSmoothed.reset(sampleRate, PARAMETER_SMOOTHING_TIME);
+    mPresetDuck.reset(sampleRate, PRESET_FADE_TIME);
+    mBypassFade.reset(sampleRate, BYPASS_FADE_TIME);
+
+    // One delay line channel per input channel
+    mNumChannels = jlimit(1, MAX_CHANNELS, numChannels);
+
+    // The caller picks its precision before preparing - only that one gets filters and a dry line
+    if (doublePrecision) {
+        prepareHostPrecision(mDoubleState);
+        mFloatState.releaseHostPrecision();
+    }
+    else {
+        prepareHostPrecision(mFloatState);
+        mDoubleState.releaseHostPrecision();
+    }
+
+    // Delay memory for the highest core rate at this host rate, in every storage precision, so the oversampling
+    // order and the storage precision can change while playing without allocating - only the live window moves.
+    // Reservations only grow, so re-preparing at the same rate or below never reallocates.
+    const int maxDelayLineLength = getDelayLineLength(sampleRate * (1 << MAX_OVERSAMPLING_ORDER));
+
+    mFloatState.delayLine.reserve(mNumChannels, maxDelayLineLength);
+    mFloatState.compactLine.reserve(mNumChannels, maxDelayLineLength);
+    mDoubleState.delayLine.reserve(mNumChannels, maxDelayLineLength);
+
+    // Tile scratch for the prepared channel count, in both precisions the core can compute in (32 and 16 bit
+    // storage compute in float, 64 bit in double)
+    const int numTaps = MAX_TILE_SIZE * mNumChannels * MAX_VOICES;
+
+    mFloatState.allocateScratch(mNumChannels);
+    mDoubleState.allocateScratch(mNumChannels);
+    mDelayTime.calloc(numTaps);
+    mReadOffset.calloc(numTaps);
+    mReadFrac.calloc(numTaps);
+    mCompactFrames.calloc(MAX_TILE_SIZE * mNumChannels);
+
+    // Initialize LFO
+    mLFO.setMode(mLFOMode);
+    mLFO.setControlRateInterval(mLFOControlRateInterval);
+
+    reset();
+
+   #if CHORUSFLANGER_PROFILING
+    mProfiler.prepare(sampleRate); // allocates the trace buffer - only worth it where something is recorded
+   #endif
+}
+
+void ChorusFlangerEngine::release()
+{
+    mFloatState.delayLine.release();
+    mFloatState.compactLine.release();
+    mFloatState.releaseHostPrecision();
+    mDoubleState.delayLine.release();
+    mDoubleState.releaseHostPrecision();
+
+    mFloatState.releaseScratch();
+    mDoubleState.releaseScratch();
+    mDelayTime.free();
+    mReadOffset.free();
+    mReadFrac.free();
+    mCompactFrames.free();
+}
+
+void ChorusFlangerEngine::reset()
+{
+    if (mNumChannels == 0) {
+        return; // not prepared yet - there is nothing to clear
+    }
+
+    // Reset while bypassed, stay bypassed rather than fading out from the start (prepareCore clears the core)
+    mPresetDuck.setCurrentAndTargetValue(1.0f);
+    mBypassFade.setCurrentAndTargetValue(mBypassFade.getTargetValue());
+    mBypassed = false;
+    mBypassRefillSamples = 0;
+
+    // Start the smoothed parameters at their current values, so nothing glides in on playback start
+    updateParameterSnapshot();
+    jumpToTargets();
+
+    mDelayPrecision = mParameters.delayPrecision;
+    prepareCore(mParameters.oversampling);
+
+    mLFO.reset();
+
+    // Position 0 is phase 0, at the rate the parameters start at
+    mSamplePosition = 0;
+    mLFOAnchorPosition = 0;
+    mLFOAnchorPhase = 0;
+    mLFOAnchorRate = mRateSmoothed.getTargetValue();
+
+    mSleeping = false;
+    mQuietSamples = 0;
+}
+
+void ChorusFlangerEngine::process(float* const* channels, int numChannels, int numSamples, bool bypassed)
+{
+    processEvents(channels, numChannels, numSamples, nullptr, 0, bypassed);
+}
+
+void ChorusFlangerEngine::process(double* const* channels, int numChannels, int numSamples, bool bypassed)
+{
+    processEvents(channels, numChannels, numSamples, nullptr, 0, bypassed);
+}
+
+void ChorusFlangerEngine::process(float* const* channels, int numChannels, int numSamples,
+                                  const ChorusFlangerParameterEvent* events, int numEvents, bool bypassed)
+{
+    processEvents(channels, numChannels, numSamples, events, numEvents, bypassed);
+}
+
+void ChorusFlangerEngine::process(double* const* channels, int numChannels, int numSamples,
+                                  const ChorusFlangerParameterEvent* events, int numEvents, bool bypassed)
+{
+    processEvents(channels, numChannels, numSamples, events, numEvents, bypassed);
+}
+
+double ChorusFlangerEngine::getTailLengthSeconds(const ChorusFlangerParameters& parameters) const
+{
+    // Worst case: every pass round the feedback loop takes the longest delay of the type and loses only the
+    // feedback amount, so it takes log(threshold) / log(feedback) passes to decay into silence
+    const ChorusFlangerParameters limited = parameters.limited();
+    const float feedback = limited.feedback;
+    const double maxDelayTime = (limited.type == 0) ? CHORUS_MAX_DELAY_TIME : FLANGER_MAX_DELAY_TIME;
+
+    double numPasses = 1;
+
+    if (feedback > 0) {
+        numPasses += std::log(SILENCE_THRESHOLD) / std::log(feedback);
+    }
+
+    return maxDelayTime * numPasses + mDryLatency / mSampleRate;
+}
+
+void ChorusFlangerEngine::duckOut()
+{
+    // From wherever the duck is, if the last switch is still fading in
+    mPresetDuck.setTargetValue(0.0f);
+}
+
+bool ChorusFlangerEngine::isDuckedOut() const
+{
+    // Asleep or bypassed there is no wet signal to duck, otherwise wait for the duck to reach the bottom
+    return mSleeping || mBypassed || ! mPresetDuck.isSmoothing();
+}
+
+void ChorusFlangerEngine::jumpToParameters(const ChorusFlangerParameters& parameters)
+{
+    // The wet signal is out, so there is nothing to glide for
+    mParameters = parameters.limited();
+    updateParameterSnapshot();
+    jumpToTargets();
+}
+
+void ChorusFlangerEngine::duckIn()
+{
+    if (mSleeping || mBypassed) {
+        mPresetDuck.setCurrentAndTargetValue(1.0f);
+    }
+    else {
+        mPresetDuck.setTargetValue(1.0f);
+    }
+}
+
+float ChorusFlangerEngine::getDelayTimeMs(int channel) const
+{
+    // The last tile's delay times are still in the scratch, once there is one
+    if (mDelayTime == nullptr) {
+        return 0.0f;
+    }
+
+    const int tap = jlimit(0, jmax(0, mNumChannels - 1), channel) * mNumVoices;
+    return (float)(fromFixedDelayTime(mDelayTime[tap]) * 1000.0 / mCoreSampleRate);
+}
+
+template <typename SampleType>
+void ChorusFlangerEngine::prepareHostPrecision(AudioState<SampleType>& state)
+{
+    // Build the half-band filters for every oversampling order, so the order can change while playing without
+    // allocating. Linear phase FIR stages with a whole-sample latency keep the wet signal exactly in line with
+    // the delayed dry signal, so the flanger's notches land where they would without oversampling.
+    int maxLatency = 0;
+
+    for (int order = 1; order <= MAX_OVERSAMPLING_ORDER; order++) {
+        auto& oversampling = state.oversampling[order - 1];
+
+        oversampling.reset(new dsp::Oversampling<SampleType>((size_t)mNumChannels, (size_t)order,
+                                                             dsp::Oversampling<SampleType>::filterHalfBandFIREquiripple, true, true));
+        oversampling->initProcessing(OVERSAMPLING_CHUNK_SIZE);
+
+        maxLatency = jmax(maxLatency, (int)oversampling->getLatencyInSamples());
+    }
+
+    state.dryDelay.setSize(mNumChannels, maxLatency + OVERSAMPLING_CHUNK_SIZE);
+}
+
+template <typename SampleType>
+void ChorusFlangerEngine::AudioState<SampleType>::releaseHostPrecision()
+{
+    for (auto& filters : oversampling) {
+        filters.reset();
+    }
+
+    dryDelay.release();
+}
+
+template <typename SampleType>
+void ChorusFlangerEngine::AudioState<SampleType>::allocateScratch(int numChannels)
+{
+    const int numTaps = MAX_TILE_SIZE * numChannels * MAX_VOICES;
+
+    taps.calloc(numTaps);
+    points.calloc(MAX_INTERPOLATION_POINTS * numTaps);
+    delayed.calloc(MAX_TILE_SIZE * numChannels);
+    frames.calloc(MAX_TILE_SIZE * numChannels);
+}
+
+template <typename SampleType>
+void ChorusFlangerEngine::AudioState<SampleType>::releaseScratch()
+{
+    taps.free();
+    points.free();
+    delayed.free();
+    frames.free();
+}
+
+template <typename SampleType>
+void ChorusFlangerEngine::AudioState<SampleType>::clearCore()
+{
+    delayLine.clear();
+    compactLine.clear();
+    clearLoop();
+}
+
+template <typename SampleType>
+void ChorusFlangerEngine::AudioState<SampleType>::clearLoop()
+{
+    for (int channel = 0; channel < MAX_CHANNELS; channel++) {
+        feedback[channel] = 0;
+    }
+
+    FloatVectorOperations::clear(interpolatorState, MAX_CHANNELS * MAX_VOICES);
+}
+
+void ChorusFlangerEngine::clearInterpolatorState()
+{
+    FloatVectorOperations::clear(mFloatState.interpolatorState, MAX_CHANNELS * MAX_VOICES);
+    FloatVectorOperations::clear(mDoubleState.interpolatorState, MAX_CHANNELS * MAX_VOICES);
+}
+
+void ChorusFlangerEngine::prepareCore(int oversamplingOrder)
+{
+    mOversamplingOrder = oversamplingOrder;
+    mCoreSampleRate = mSampleRate * (1 << oversamplingOrder);
+
+    // Keep the LFO where it is - only its step size depends on the rate
+    const double phase = mLFO.getPhase();
+    mLFO.prepare(mCoreSampleRate);
+    mLFO.reset(phase);
+
+    // The per-sample ramps advance at the core rate (this also lands them on their targets)
+    mDepthSmoothed.reset(mCoreSampleRate, PARAMETER_SMOOTHING_TIME);
+    mRateSmoothed.reset(mCoreSampleRate, PARAMETER_SMOOTHING_TIME);
+    mPhaseOffsetSmoothed.reset(mCoreSampleRate, PARAMETER_SMOOTHING_TIME);
+    mFeedbackSmoothed.reset(mCoreSampleRate, PARAMETER_SMOOTHING_TIME);
+
+    // The delay line and everything in it are in core rate samples, so the old contents are no use. Only the
+    // line of the current storage precision is live - the others keep their reservation and nothing else.
+    const int delayLineLength = getDelayLineLength(mCoreSampleRate);
+
+    if (mDelayPrecision == 1) {
+        mDoubleState.delayLine.setSize(mNumChannels, delayLineLength);
+        mDoubleState.clearCore();
+    }
+    else if (mDelayPrecision == 2) {
+        mFloatState.compactLine.setSize(mNumChannels, delayLineLength);
+        mFloatState.clearCore();
+    }
+    else {
+        mFloatState.delayLine.setSize(mNumChannels, delayLineLength);
+        mFloatState.clearCore();
+    }
+
+    mPhaseOffsetRotated = -1; // the channel count or sample rate may have changed, so the voice layout needs working out again
+
+    // Tile length - shorter than the minimum delay by one sample plus the interpolators' lookahead, so even
+    // the newest interpolation point of the shortest read head stays behind the first sample of the tile
+    mTileSize = jlimit(1, MAX_TILE_SIZE, (int)(mCoreSampleRate * MIN_DELAY_TIME) - 1 - INTERPOLATION_LOOKAHEAD);
+
+    // The filters add latency to the wet signal - the dry signal is held back by the same amount (getLatencySamples)
+    mDryLatency = 0;
+
+    if (mDoublePrecision) {
+        mDryLatency = resetHostFilters(mDoubleState, oversamplingOrder);
+    }
+    else {
+        mDryLatency = resetHostFilters(mFloatState, oversamplingOrder);
+    }
+
+    // Everything still audible is within reach of the read heads (at most a delay line's worth of host rate
+    // samples back) or inside the oversampling filters
+    mSleepAfterSamples = getDelayLineLength(mSampleRate) + mDryLatency;
+}
+
+template <typename SampleType>
+int ChorusFlangerEngine::resetHostFilters(AudioState<SampleType>& state, int oversamplingOrder)
+{
+    state.dryDelay.clear();
+
+    if (oversamplingOrder == 0 || state.oversampling[oversamplingOrder - 1] == nullptr) {
+        return 0;
+    }
+
+    auto& oversampling = *state.oversampling[oversamplingOrder - 1];
+    oversampling.reset();
+
+    return (int)oversampling.getLatencyInSamples();
+}
+
+void ChorusFlangerEngine::setLFOMode(LFO::Mode mode, int controlRateInterval)
+{
+    mLFOMode = mode;
+    mLFOControlRateInterval = controlRateInterval;
+}
+
+void ChorusFlangerEngine::seek(int64 samplePosition)
+{
+    // The next block puts the LFO there (see syncLFO)
+    mSamplePosition = samplePosition;
+}
+
+void ChorusFlangerEngine::prime(const float* const* history, int numChannels, int numSamples, int64 position)
+{
+    primeFrom(history, numChannels, numSamples, position);
+}
+
+void ChorusFlangerEngine::prime(const double* const* history, int numChannels, int numSamples, int64 position)
+{
+    primeFrom(history, numChannels, numSamples, position);
+}
+
+template <typename SampleType>
+void ChorusFlangerEngine::primeFrom(const SampleType* const* history, int numChannels, int numSamples, int64 position)
+{
+    // A run from the start would have finished gliding long ago
+    updateParameterSnapshot();
+    jumpToTargets();
+
+    seek(position - numSamples);
+
+    // In blocks of the prepared size, so the blocks line up with a run from the start that used that size too.
+    // processBlock opens no block scope, so the profiler drops these blocks' stages rather than adding them to the
+    // next host callback's
+    const int blockSize = jmax(1, mMaximumBlockSize);
+    AudioBuffer<SampleType> block(numChannels, blockSize);
+
+    for (int offset = 0; offset < numSamples; offset += blockSize) {
+        const int blockLength = jmin(blockSize, numSamples - offset);
+
+        for (int channel = 0; channel < numChannels; channel++) {
+            block.copyFrom(channel, 0, history[channel] + offset, blockLength);
+        }
+
+        processBlock(block.getArrayOfWritePointers(), numChannels, blockLength, false);
+    }
+
+    seek(position); // even if the history was not for this precision or layout, and process left it alone
+}
+
+int ChorusFlangerEngine::getDelayLineLength(double sampleRate)
+{
+    // The longest delay plus the interpolation points behind it, plus one tile since a whole tile is read before it is written
+    return (int)std::ceil(sampleRate * MAX_DELAY_TIME) + INTERPOLATION_MARGIN + MAX_TILE_SIZE;
+}
+
+template <typename SampleType>
+void ChorusFlangerEngine::processEvents(SampleType* const* channels, int numChannels, int numSamples,
+                                        const ChorusFlangerParameterEvent* events, int numEvents, bool bypassed)
+{
+    PROFILE_BLOCK(mProfiler, numSamples);
+
+    // The events have to come in order - one earlier than the one before it is taken late, at that one's stretch
+    for (int index = 1; index < numEvents; index++) {
+        jassert(events[index - 1].sampleOffset <= events[index].sampleOffset);
+    }
+
+    // Each stretch between changes runs through the tiled kernels as a block of its own, so a change costs one
+    // block boundary rather than a check on every sample
+    SampleType* stretchChannels[MAX_CHANNELS];
+    numChannels = jmin(numChannels, MAX_CHANNELS);
+
+    int stretchStart = 0;
+    int event = 0;
+
+    for (;;) {
+        // Every change due by the start of the stretch
+        while (event < numEvents && events[event].sampleOffset <= stretchStart) {
+            applyEvent(mParameters, events[event++]);
+        }
+
+        // A change to the value a parameter already has needs no stretch of its own - hosts repeat values a lot
+        while (event < numEvents) {
+            ChorusFlangerParameters changed = mParameters;
+            applyEvent(changed, events[event]);
+
+            if (changed != mParameters) {
+                break;
+            }
+
+            event++;
+        }
+
+        const int stretchEnd = (event < numEvents) ? jmin(numSamples, events[event].sampleOffset) : numSamples;
+
+        if (stretchEnd <= stretchStart) {
+            break;
+        }
+
+        for (int channel = 0; channel < numChannels; channel++) {
+            stretchChannels[channel] = channels[channel] + stretchStart;
+        }
+
+        processBlock(stretchChannels, numChannels, stretchEnd - stretchStart, bypassed);
+        stretchStart = stretchEnd;
+    }
+
+    // Changes past the end of the block, for the next one
+    while (event < numEvents) {
+        applyEvent(mParameters, events[event++]);
+    }
+}
+
+void ChorusFlangerEngine::applyEvent(ChorusFlangerParameters& parameters, const ChorusFlangerParameterEvent& event)
+{
+    switch (event.parameter)
+    {
+        case ChorusFlangerParameterID::dryWet: parameters.dryWet = event.value; break;
+        case ChorusFlangerParameterID::depth: parameters.depth = event.value; break;
+        case ChorusFlangerParameterID::rate: parameters.rate = event.value; break;
+        case ChorusFlangerParameterID::phaseOffset: parameters.phaseOffset = event.value; break;
+        case ChorusFlangerParameterID::feedback: parameters.feedback = event.value; break;
+        case ChorusFlangerParameterID::type: parameters.type = roundToInt(event.value); break;
+        case ChorusFlangerParameterID::voices: parameters.voices = roundToInt(event.value); break;
+        case ChorusFlangerParameterID::oversampling: parameters.oversampling = roundToInt(event.value); break;
+        case ChorusFlangerParameterID::interpolation: parameters.interpolation = roundToInt(event.value); break;
+        case ChorusFlangerParameterID::delayPrecision: parameters.delayPrecision = roundToInt(event.value); break;
+        default: jassertfalse; return; // not a parameter - ignored
+    }
+
+    // Clamped like setParameters, and before processEvents compares it, so an out of range repeat is a no-op too
+    parameters = parameters.limited();
+}
+
+template <typename SampleType>
+void ChorusFlangerEngine::processBlock(SampleType* const* channels, int numChannels, int numSamples, bool bypassed)
+{
+    juce::ScopedNoDenormals noDenormals;
+
+    numChannels = jmin(mNumChannels, numChannels);
+    auto& hostState = getAudioState<SampleType>();
+
+    if (numChannels == 0 || numChannels != hostState.dryDelay.getNumChannels() || hostState.oversampling[0] == nullptr) {
+        updateParameterSnapshot();
+        return; // not prepared for this layout or precision yet - leave the audio dry
+    }
+
+    // One consistent parameter snapshot for the whole block
+    updateParameterSnapshot();
+
+    // Bypassing fades the wet signal out, and un-bypassing brings it back - the core runs as usual until it is out.
+    // A line that missed audio while bypassed has to refill first, or the wet signal would come back with a step.
+    mBypassFade.setTargetValue((bypassed || mBypassRefillSamples > 0) ? 0.0f : 1.0f);
+
+    // Refilling, the line takes the input alone, so the step where it starts doesn't go round the feedback loop
+    if (mBypassRefillSamples > 0) {
+        mFeedbackSmoothed.setCurrentAndTargetValue(0.0f);
+    }
+
+    // A new oversampling order or storage precision restarts the core (the filters and delay memory are already there)
+    int oversamplingOrder = mParameters.oversampling;
+    int delayPrecision = mParameters.delayPrecision;
+
+    if (oversamplingOrder != mOversamplingOrder || delayPrecision != mDelayPrecision) {
+        mDelayPrecision = delayPrecision;
+        prepareCore(oversamplingOrder);
+    }
+
+    // Silent input - while the tail has died away too there is nothing to compute
+    SampleType inputPeak = 0;
+
+    for (int channel = 0; channel < numChannels && numSamples > 0; channel++) {
+        auto range = FloatVectorOperations::findMinAndMax(channels[channel], numSamples);
+        inputPeak = jmax(inputPeak, -range.getStart(), range.getEnd());
+    }
+
+    const bool inputSilent = inputPeak < SILENCE_THRESHOLD;
+
+    if (bypassed && ! mBypassFade.isSmoothing()) {
+        processBypassed(channels, numChannels, numSamples, inputSilent);
+        mSamplePosition += numSamples;
+        return;
+    }
+
+    if (mBypassed) {
+        leaveBypass<SampleType>();
+    }
+
+    if (mSleeping) {
+        if (inputSilent) {
+            skipSilentBlock(numSamples);
+            mSamplePosition += numSamples;
+            return;
+        }
+
+        wakeUp<SampleType>();
+    }
+
+    syncLFO();
+    mWetPeak = 0;
+
+    if (mOversamplingOrder == 0) {
+        processCore(channels, numSamples, true);
+    }
+    else {
+        processOversampled(channels, numChannels, numSamples);
+    }
+
+    // Sleep once the input and the wet signal have both been quiet long enough for the whole delay line to be
+    if (inputSilent && mWetPeak < SILENCE_THRESHOLD) {
+        mQuietSamples = jmin(mQuietSamples + numSamples, mSleepAfterSamples);
+        mSleeping = (mQuietSamples >= mSleepAfterSamples);
+    }
+    else {
+        mQuietSamples = 0;
+    }
+
+    mBypassRefillSamples = jmax(0, mBypassRefillSamples - numSamples);
+    mSamplePosition += numSamples;
+}
+
+void ChorusFlangerEngine::skipSilentBlock(int numSamples)
+{
+    // Nothing is audible, so the smoothed parameters jump to where they are heading, and the LFO moves on
+    // as if it had run, so it picks up in the same place when the input returns
+    jumpToTargets();
+    syncLFO();
+
+    mLFO.reset(getLFOPhaseAt(mSamplePosition + numSamples));
+
+    // A bypass fade can't be heard either - otherwise it would wait for the input to finish it
+    mBypassFade.setCurrentAndTargetValue(mBypassFade.getTargetValue());
+}
+
+void ChorusFlangerEngine::syncLFO()
+{
+    const float rate = mRateSmoothed.getCurrentValue();
+
+    // Gliding to a new rate, the LFO runs on by itself and the anchor goes along with it. Once the rate settles
+    // the anchor stays put, at the phase the glide left the LFO at.
+    if (mRateSmoothed.isSmoothing() || rate != mLFOAnchorRate) {
+        mLFOAnchorPosition = mSamplePosition;
+        mLFOAnchorPhase = mLFO.getPhase();
+        mLFOAnchorRate = mRateSmoothed.isSmoothing() ? -1.0f : rate;
+        return;
+    }
+
+    // Otherwise the phase comes from the position, so it can't depend on what ran before - the block sizes,
+    // a seek, the rounding in the LFO
+    mLFO.reset(getLFOPhaseAt(mSamplePosition));
+}
+
+double ChorusFlangerEngine::getLFOPhaseAt(int64 position) const
+{
+    const double phase = mLFOAnchorPhase + (double)(position - mLFOAnchorPosition) * mLFOAnchorRate / mSampleRate;
+    return phase - std::floor(phase);
+}
+
+void ChorusFlangerEngine::jumpToTargets()
+{
+    mDryWetSmoothed.setCurrentAndTargetValue(mDryWetSmoothed.getTargetValue());
+    mDepthSmoothed.setCurrentAndTargetValue(mDepthSmoothed.getTargetValue());
+    mRateSmoothed.setCurrentAndTargetValue(mRateSmoothed.getTargetValue());
+    mPhaseOffsetSmoothed.setCurrentAndTargetValue(mPhaseOffsetSmoothed.getTargetValue());
+    mFeedbackSmoothed.setCurrentAndTargetValue(mFeedbackSmoothed.getTargetValue());
+}
+
+template <typename SampleType>
+void ChorusFlangerEngine::wakeUp()
+{
+    // The delay line stopped being written when the core went to sleep, and what is left in it and in the
+    // filters is below the threshold anyway - start from silence rather than from that stale audio
+    mSleeping = false;
+    mQuietSamples = 0;
+
+    if (mDelayPrecision == 1) {
+        mDoubleState.clearCore();
+    }
+    else {
+        mFloatState.clearCore(); // 32 and 16 bit storage both compute in float
+    }
+
+    resetHostFilters(getAudioState<SampleType>(), mOversamplingOrder);
+}
+
+template <typename SampleType>
+void ChorusFlangerEngine::processBypassed(SampleType* const* channels, int numChannels, int numSamples, bool inputSilent)
+{
+    mBypassed = true;
+
+    // None of the effect is heard, so the parameters and the LFO move on as they do asleep
+    skipSilentBlock(numSamples);
+
+    // Not fed, audio the line misses stays missing until a whole line (and the filters) has gone by since. Fed,
+    // the line only holds silence once the input has been silent for a whole line - feeding can stop there.
+    if (mBypassMode.load(std::memory_order_relaxed) == BypassMode::sleep) {
+        mSleeping = true;
+        mBypassRefillSamples = inputSilent ? jmax(0, mBypassRefillSamples - numSamples) : mSleepAfterSamples;
+    }
+    else if (inputSilent) {
+        mQuietSamples = jmin(mQuietSamples + numSamples, mSleepAfterSamples);
+        mSleeping = (mQuietSamples >= mSleepAfterSamples);
+    }
+    else {
+        mQuietSamples = 0;
+        mSleeping = false;
+    }
+
+    if (mOversamplingOrder == 0) {
+        if (! mSleeping) {
+            feedCore(channels, numSamples);
+        }
+
+        return; // the output is the input
+    }
+
+    // Oversampled, the host still compensates for the latency - the output keeps coming through the dry line
+    SampleType* chunkChannels[MAX_CHANNELS];
+
+    for (int chunkStart = 0; chunkStart < numSamples; chunkStart += OVERSAMPLING_CHUNK_SIZE) {
+
+        int chunkLength = jmin(OVERSAMPLING_CHUNK_SIZE, numSamples - chunkStart);
+
+        for (int channel = 0; channel < numChannels; channel++) {
+            chunkChannels[channel] = channels[channel] + chunkStart;
+        }
+
+        if (! mSleeping) {
+            feedCore(chunkChannels, chunkLength);
+        }
+
+        writeDryDelay(chunkChannels, chunkLength);
+        copyDelayedDry(chunkChannels, chunkLength);
+    }
+}
+
+template <typename SampleType>
+void ChorusFlangerEngine::feedCore(const SampleType* const* input, int numSamples)
+{
+    if (mDelayPrecision == 1) {
+        feedDelayLine<SampleType, double, double>(input, numSamples);
+    }
+    else if (mDelayPrecision == 2) {
+        feedDelayLine<SampleType, float, int16>(input, numSamples);
+    }
+    else {
+        feedDelayLine<SampleType, float, float>(input, numSamples);
+    }
+}
+
+template <typename SampleType, typename StorageType, typename LineType>
+void ChorusFlangerEngine::feedDelayLine(const SampleType* const* input, int numSamples)
+{
+    auto& state = getAudioState<StorageType>();
+    const int factor = 1 << mOversamplingOrder;
+    const int hostTileSize = MAX_TILE_SIZE / factor;
+
+    // Interleave into frames a tile at a time. Oversampled, each input sample is held for the whole factor -
+    // the images that leaves are above the host rate's Nyquist, where the downsampling filters take them out.
+    for (int tileStart = 0; tileStart < numSamples; tileStart += hostTileSize) {
+
+        int tileLength = jmin(hostTileSize, numSamples - tileStart);
+
+        for (int i = 0; i < tileLength; i++) {
+            for (int channel = 0; channel < mNumChannels; channel++) {
+                const StorageType sample = (StorageType)input[channel][tileStart + i];
+
+                for (int repeat = 0; repeat < factor; repeat++) {
+                    state.frames[(i * factor + repeat) * mNumChannels + channel] = sample;
+                }
+            }
+        }
+
+        if constexpr (std::is_same<LineType, int16>::value) {
+            packCompactSamples(state.frames, mCompactFrames, tileLength * factor * mNumChannels);
+            state.compactLine.write(mCompactFrames, tileLength * factor);
+        }
+        else {
+            state.delayLine.write(state.frames, tileLength * factor);
+        }
+    }
+}
+
+template <typename SampleType>
+void ChorusFlangerEngine::leaveBypass()
+{
+    // Whatever fed the line, the feedback and the read heads stopped with the core - start them, and the
+    // oversampling filters, from silence. The fade back in covers the few samples the filters take to fill.
+    // The dry line kept running, and must not be cleared, or the dry signal would drop out for the latency.
+    mBypassed = false;
+
+    // Asleep, the line stopped being written too - it restarts from silence as well, as after waking up
+    if (mDelayPrecision == 1) {
+        if (mSleeping) {
+            mDoubleState.clearCore();
+        }
+        else {
+            mDoubleState.clearLoop();
+        }
+    }
+    else {
+        if (mSleeping) {
+            mFloatState.clearCore();
+        }
+        else {
+            mFloatState.clearLoop();
+        }
+    }
+
+    mSleeping = false;
+    mQuietSamples = 0;
+
+    // The line holds no feedback - bring it in gradually, or the read heads would meet a step where it restarts
+    const float feedback = mFeedbackSmoothed.getTargetValue();
+    mFeedbackSmoothed.setCurrentAndTargetValue(0.0f);
+    mFeedbackSmoothed.setTargetValue(feedback);
+
+    auto& hostState = getAudioState<SampleType>();
+
+    if (mOversamplingOrder > 0) {
+        hostState.oversampling[mOversamplingOrder - 1]->reset();
+    }
+}
+
+template <typename SampleType>
+void ChorusFlangerEngine::processCore(SampleType* const* channels, int numSamples, bool mixDry)
+{
+    if (mDelayPrecision == 1) {
+        processCoreIn<SampleType, double, double>(channels, numSamples, mixDry);
+    }
+    else if (mDelayPrecision == 2) {
+        processCoreIn<SampleType, float, int16>(channels, numSamples, mixDry);
+    }
+    else {
+        processCoreIn<SampleType, float, float>(channels, numSamples, mixDry);
+    }
+}
+
+template <typename SampleType, typename StorageType, typename LineType>
+void ChorusFlangerEngine::processCoreIn(SampleType* const* channels, int numSamples, bool mixDry)
+{
+    // One specialisation per interpolator and type, picked once here rather than per sample
+    using TileProcessor = void (ChorusFlangerEngine::*)(SampleType* const*, int, bool);
+
+    static const TileProcessor tileProcessors[NUM_INTERPOLATORS][2] = {
+        { &ChorusFlangerEngine::processTiles<SampleType, StorageType, LineType, LinearInterpolator, true>,
+          &ChorusFlangerEngine::processTiles<SampleType, StorageType, LineType, LinearInterpolator, false> },
+        { &ChorusFlangerEngine::processTiles<SampleType, StorageType, LineType, CubicHermiteInterpolator, true>,
+          &ChorusFlangerEngine::processTiles<SampleType, StorageType, LineType, CubicHermiteInterpolator, false> },
+        { &ChorusFlangerEngine::processTiles<SampleType, StorageType, LineType, LagrangeInterpolator, true>,
+          &ChorusFlangerEngine::processTiles<SampleType, StorageType, LineType, LagrangeInterpolator, false> },
+        { &ChorusFlangerEngine::processTiles<SampleType, StorageType, LineType, ThiranInterpolator, true>,
+          &ChorusFlangerEngine::processTiles<SampleType, StorageType, LineType, ThiranInterpolator, false> }
+    };
+
+    (this->*tileProcessors[mInterpolation][mType == 0 ? 0 : 1])(channels, numSamples, mixDry);
+}
+
+template <typename SampleType, typename StorageType, typename LineType, typename Interpolator, bool isChorus>
+void ChorusFlangerEngine::processTiles(SampleType* const* channels, int numSamples, bool mixDry)
+{
+    // Process the buffer in tiles. A tile is shorter than the minimum delay, so every read head in it only
+    // sees samples written by earlier tiles - each stage can then run over the whole tile as a vector kernel.
+    auto& state = getAudioState<StorageType>();
+    SampleType* tileChannels[MAX_CHANNELS];
+
+    for (int tileStart = 0; tileStart < numSamples; tileStart += mTileSize) {
+
+        int tileLength = jmin(mTileSize, numSamples - tileStart);
+
+        for (int channel = 0; channel < mNumChannels; channel++) {
+            tileChannels[channel] = channels[channel] + tileStart;
+        }
+
+        {
+            PROFILE_STAGE(mProfiler, modulationStage);
+            generateModulation<isChorus>(tileLength);
+        }
+
+        {
+            PROFILE_STAGE(mProfiler, readStage);
+            readDelayLine<StorageType, LineType, Interpolator, isChorus>(tileLength);
+
+            // Track how loud the tail still is, for silence detection
+            auto wetRange = FloatVectorOperations::findMinAndMax(state.delayed.get(), tileLength * mNumChannels);
+            mWetPeak = jmax(mWetPeak, (float)-wetRange.getStart(), (float)wetRange.getEnd());
+        }
+
+        {
+            PROFILE_STAGE(mProfiler, writeStage);
+            writeDelayLine<SampleType, StorageType, LineType>(tileChannels, tileLength); // must run before the mix overwrites the dry input
+        }
+
+        PROFILE_STAGE(mProfiler, mixStage);
+
+        if (mixDry) {
+            mixDryWet<SampleType, StorageType>(tileChannels, tileLength);
+        }
+        else {
+            copyWet<SampleType, StorageType>(tileChannels, tileLength);
+        }
+    }
+}
+
+template <typename SampleType>
+void ChorusFlangerEngine::processOversampled(SampleType* const* channels, int numChannels, int numSamples)
+{
+    auto& oversampling = *getAudioState<SampleType>().oversampling[mOversamplingOrder - 1];
+    const int factor = 1 << mOversamplingOrder;
+
+    SampleType* chunkChannels[MAX_CHANNELS];
+    SampleType* coreChannels[MAX_CHANNELS];
+
+    // Chunks no longer than the filters were prepared for, whatever block size the host sends
+    for (int chunkStart = 0; chunkStart < numSamples; chunkStart += OVERSAMPLING_CHUNK_SIZE) {
+
+        int chunkLength = jmin(OVERSAMPLING_CHUNK_SIZE, numSamples - chunkStart);
+
+        for (int channel = 0; channel < numChannels; channel++) {
+            chunkChannels[channel] = channels[channel] + chunkStart;
+        }
+
+        // Keep the dry input before the wet signal replaces it
+        {
+            PROFILE_STAGE(mProfiler, mixStage);
+            writeDryDelay(chunkChannels, chunkLength);
+        }
+
+        // Only the delay/feedback core runs at the higher rate
+        dsp::AudioBlock<SampleType> block(chunkChannels, (size_t)numChannels, (size_t)chunkLength);
+        dsp::AudioBlock<SampleType> oversampled;
+
+        {
+            PROFILE_STAGE(mProfiler, oversamplingStage);
+            oversampled = oversampling.processSamplesUp(block);
+        }
+
+        for (int channel = 0; channel < numChannels; channel++) {
+            coreChannels[channel] = oversampled.getChannelPointer((size_t)channel);
+        }
+
+        processCore(coreChannels, chunkLength * factor, false);
+
+        {
+            PROFILE_STAGE(mProfiler, oversamplingStage);
+            oversampling.processSamplesDown(block);
+        }
+
+        PROFILE_STAGE(mProfiler, mixStage);
+        mixDelayedDry(chunkChannels, chunkLength);
+    }
+}
+
+void ChorusFlangerEngine::updateParameterSnapshot()
+{
+    mDryWetSmoothed.setTargetValue(mParameters.dryWet);
+    mDepthSmoothed.setTargetValue(mParameters.depth);
+    mRateSmoothed.setTargetValue(mParameters.rate);
+    mPhaseOffsetSmoothed.setTargetValue(mParameters.phaseOffset);
+    mFeedbackSmoothed.setTargetValue(mParameters.feedback);
+    mType = mParameters.type;
+
+    // Extra voices are a chorus thing - the flanger keeps a single tap per channel
+    mNumVoices = (mType == 0) ? mParameters.voices : 1;
+
+    // A different interpolator can't use the old one's state
+    int interpolation = mParameters.interpolation;
+
+    if (interpolation != mInterpolation) {
+        mInterpolation = interpolation;
+        clearInterpolatorState();
+    }
+}
+
+// Writes the next numSamples values of a smoothed parameter into dest
+template <typename SmoothedValueType>
+static void fillRamp(SmoothedValueType& smoothedValue, float* dest, int numSamples)
+{
+    if (! smoothedValue.isSmoothing()) {
+        FloatVectorOperations::fill(dest, smoothedValue.getTargetValue(), numSamples);
+        return;
+    }
+
+    for (int i = 0; i < numSamples; i++) {
+        dest[i] = smoothedValue.getNextValue();
+    }
+}
+
+template <bool isChorus>
+void ChorusFlangerEngine::generateModulation(int numSamples)
+{
+    const float sampleRate = (float)mCoreSampleRate;
+
+    // Rate and phase offset move at tile rate, which is far finer than either can be heard
+    mLFO.setFrequency(mRateSmoothed.getCurrentValue());
+    mRateSmoothed.skip(numSamples);
+
+    float phaseOffset = mPhaseOffsetSmoothed.getCurrentValue();
+    mPhaseOffsetSmoothed.skip(numSamples);
+
+    if (phaseOffset != mPhaseOffsetRotated || mNumVoices != mVoiceLayoutVoices || mType != mVoiceLayoutType) {
+        updateVoiceLayout(phaseOffset);
+    }
+
+    // Generate LFO
+    mLFO.process(mLFOSin, mLFOCos, numSamples);
+
+    // Multiply by the depth parameter and the full sweep in samples - each tap scales it down by its own share
+    const float minDelayTime = isChorus ? CHORUS_MIN_DELAY_TIME : FLANGER_MIN_DELAY_TIME;
+    const float maxDelayTime = isChorus ? CHORUS_MAX_DELAY_TIME : FLANGER_MAX_DELAY_TIME;
+    const float sweep = 0.5f * (maxDelayTime - minDelayTime) * sampleRate;
+
+    fillRamp(mDepthSmoothed, mDepthRamp, numSamples);
+    FloatVectorOperations::multiply(mDepthRamp, sweep, numSamples);
+
+    // Each tap's LFO is the shared one rotated by its offset:
+    // sin(phase + offset) = sin(phase) * cos(offset) + cos(phase) * sin(offset)
+    const int numTaps = mNumChannels * (isChorus ? mNumVoices : 1);
+
+    auto getDelayTime = [this](int i, int tap) {
+        double lfo = (double)mLFOSin[i] * mPhaseOffsetCos[tap] + (double)mLFOCos[i] * mPhaseOffsetSin[tap];
+        return mVoiceCentre[tap] + lfo * mDepthRamp[i] * mVoiceSweep[tap];
+    };
+
+    // The delay times are worked out exactly at four samples spread over the tile only (every sample of a shorter
+    // tile). The read heads follow the cubic through those points as fixed point accumulators - each sample adds
+    // every difference to the one above it - so they stay within a thousandth of a sample of the exact curve,
+    // and start from the exact delay time again every tile, so nothing drifts.
+    int points[MODULATION_CURVE_POINTS];
+    const int numPoints = getModulationCurvePoints(numSamples, points);
+
+    int64 differences[MODULATION_CURVE_POINTS][MAX_CHANNELS * MAX_VOICES];
+
+    for (int tap = 0; tap < numTaps; tap++) {
+        double curve[MODULATION_CURVE_POINTS];
+        int64 start[MODULATION_CURVE_POINTS];
+
+        for (int point = 0; point < numPoints; point++) {
+            curve[point] = getDelayTime(points[point], tap);
+        }
+
+        fitModulationCurve(curve, points, numPoints, start);
+
+        for (int order = 0; order < MODULATION_CURVE_POINTS; order++) {
+            differences[order][tap] = start[order];
+        }
+    }
+
+    // The taps of one sample are contiguous, so the inner loop runs the voices and channels in SIMD lanes
+    for (int i = 0; i < numSamples; i++) {
+        int64* delayTime = mDelayTime + i * numTaps;
+
+        for (int tap = 0; tap < numTaps; tap++) {
+            delayTime[tap] = differences[0][tap];
+            differences[0][tap] += differences[1][tap];
+            differences[1][tap] += differences[2][tap];
+            differences[2][tap] += differences[3][tap];
+        }
+    }
+}
+
+int ChorusFlangerEngine::getModulationCurvePoints(int numSamples, int* points)
+{
+    const int numPoints = jmin(numSamples, MODULATION_CURVE_POINTS);
+    const int last = numSamples - 1;
+
+    for (int point = 0; point < numPoints; point++) {
+        points[point] = (numSamples > numPoints) ? last * point / (numPoints - 1) : point;
+    }
+
+    return numPoints;
+}
+
+void ChorusFlangerEngine::fitModulationCurve(double* curve, const int* points, int numPoints, int64* differences)
+{
+    // Newton divided differences, in place
+    for (int order = 1; order < numPoints; order++) {
+        for (int point = numPoints - 1; point >= order; point--) {
+            curve[point] = (curve[point] - curve[point - 1]) / (points[point] - points[point - order]);
+        }
+    }
+
+    // The cubic at the tile's first samples, then the forward differences there - the accumulators' starting values
+    double start[MODULATION_CURVE_POINTS];
+
+    for (int i = 0; i < numPoints; i++) {
+        double value = curve[numPoints - 1];
+
+        for (int point = numPoints - 2; point >= 0; point--) {
+            value = value * (i - points[point]) + curve[point];
+        }
+
+        start[i] = value;
+    }
+
+    for (int order = 1; order < numPoints; order++) {
+        for (int i = numPoints - 1; i >= order; i--) {
+            start[i] -= start[i - 1];
+        }
+    }
+
+    for (int order = 0; order < MODULATION_CURVE_POINTS; order++) {
+        differences[order] = (order < numPoints) ? toFixedDelayTime(start[order]) : 0;
+    }
+}
+
+void ChorusFlangerEngine::updateVoiceLayout(float phaseOffset)
+{
+    // The taps are numbered differently now, so per-tap interpolator state no longer lines up
+    if (mNumVoices != mVoiceLayoutVoices || mType != mVoiceLayoutType) {
+        clearInterpolatorState();
+    }
+
+    mPhaseOffsetRotated = phaseOffset;
+    mVoiceLayoutVoices = mNumVoices;
+    mVoiceLayoutType = mType;
+
+    const float sampleRate = (float)mCoreSampleRate;
+
+    // Chorus (5ms to 30 ms) or Flanger (1ms to 5 ms) - same as jmap(lfo * depth, -1, 1, min, max) * sampleRate
+    const float minDelayTime = (mType == 0) ? CHORUS_MIN_DELAY_TIME : FLANGER_MIN_DELAY_TIME;
+    const float maxDelayTime = (mType == 0) ? CHORUS_MAX_DELAY_TIME : FLANGER_MAX_DELAY_TIME;
+    const float centre = 0.5f * (minDelayTime + maxDelayTime) * sampleRate;
+    const float sweep = 0.5f * (maxDelayTime - minDelayTime) * sampleRate;
+
+    for (int channel = 0; channel < mNumChannels; channel++) {
+
+        // Spread the phase offset evenly from the first channel (none) to the last (all of it) -
+        // for stereo that is left at the LFO phase and right at LFO phase + offset
+        float channelOffset = (mNumChannels > 1) ? phaseOffset * channel / (mNumChannels - 1) : 0.0f;
+
+        for (int voice = 0; voice < mNumVoices; voice++) {
+            const int tap = channel * mNumVoices + voice;
+
+            // Voices are spaced evenly around the LFO cycle...
+            float voiceOffset = channelOffset + (float)voice / mNumVoices;
+            mPhaseOffsetCos[tap] = cos(2 * MathConstants<float>::pi * voiceOffset);
+            mPhaseOffsetSin[tap] = sin(2 * MathConstants<float>::pi * voiceOffset);
+
+            // ...and their centres are spread across the range (-1 to 1), with the sweep narrowed to match
+            // so every voice stays inside the type's delay range. A single voice sits in the middle.
+            float position = (mNumVoices > 1) ? 2.0f * voice / (mNumVoices - 1) - 1.0f : 0.0f;
+            mVoiceCentre[tap] = centre + VOICE_CENTRE_SPREAD * position * sweep;
+            mVoiceSweep[tap] = 1.0f - VOICE_CENTRE_SPREAD * std::abs(position);
+        }
+    }
+
+    // All voices feed back into the same line, so scaling their sum by 1 / voices keeps the loop gain at the feedback amount
+    mVoiceGain = 1.0f / mNumVoices;
+}
+
+template <typename StorageType, typename LineType, typename Interpolator, bool isChorus>
+void ChorusFlangerEngine::readDelayLine(int numSamples)
+{
+    static_assert(Interpolator::numPoints <= MAX_INTERPOLATION_POINTS, "points is too small for this interpolator");
+    static_assert(Interpolator::numNewerPoints <= INTERPOLATION_LOOKAHEAD, "the tile is too long for this interpolator");
+    static_assert(Interpolator::firstPointDelay <= INTERPOLATION_MARGIN, "the delay line is too short for this interpolator");
+    static_assert(Interpolator::numPoints <= DELAY_LINE_GUARD_FRAMES, "the guard frames are too few for this interpolator");
+
+    auto& state = getAudioState<StorageType>();
+    const auto& delayLine = state.template getDelayLine<LineType>();
+
+    const int writePosition = delayLine.getWritePosition();
+    const int numChannels = mNumChannels;
+    const int numVoices = isChorus ? mNumVoices : 1;
+    const int numTaps = numChannels * numVoices;
+    const int numValues = numSamples * numTaps;
+
+    // A single voice needs no summing, so it interpolates straight into the delayed output
+    StorageType* taps = (numVoices == 1) ? state.delayed : state.taps;
+
+    // Split every read head into whole samples and a fraction - a plain loop over all taps, so it vectorises
+    for (int index = 0; index < numValues; index++) {
+        Interpolator::split(mDelayTime[index], mReadOffset[index], mReadFrac[index]);
+    }
+
+    // Gather the interpolation points for every read head in the tile. The points of one read head are consecutive
+    // frames, and the mirrored guard frames make them contiguous, so neither the read position nor the later
+    // points need a wrap check.
+    StorageType* points[MAX_INTERPOLATION_POINTS];
+
+    for (int point = 0; point < MAX_INTERPOLATION_POINTS; point++) {
+        points[point] = state.points + point * MAX_TILE_SIZE * mNumChannels * MAX_VOICES;
+    }
+
+    for (int i = 0; i < numSamples; i++) {
+        const int oldest = writePosition + i - Interpolator::firstPointDelay;
+
+        for (int channel = 0; channel < numChannels; channel++) {
+            const int first = (i * numChannels + channel) * numVoices;
+
+            for (int index = first; index < first + numVoices; index++) {
+                const LineType* frame = delayLine.getFrame(oldest - mReadOffset[index]) + channel;
+
+                for (int point = 0; point < Interpolator::numPoints; point++) {
+                    if constexpr (std::is_same<LineType, int16>::value) {
+                        points[point][index] = unpackCompactSample(frame[point * numChannels]);
+                    }
+                    else {
+                        points[point][index] = frame[point * numChannels];
+                    }
+                }
+            }
+        }
+    }
+
+    // Interpolate the whole tile, all taps at once
+    Interpolator::process(points, mReadFrac, taps, numSamples, numTaps, state.interpolatorState);
+
+    if (numVoices == 1) {
+        return;
+    }
+
+    // Sum the voices of each channel - they are adjacent, so each sum is one short horizontal add
+    for (int index = 0; index < numSamples * numChannels; index++) {
+        const StorageType* voices = state.taps + index * numVoices;
+        StorageType sum = 0;
+
+        for (int voice = 0; voice < numVoices; voice++) {
+            sum += voices[voice];
+        }
+
+        state.delayed[index] = sum * mVoiceGain;
+    }
+}
+
+template <typename SampleType, typename StorageType, typename LineType>
+void ChorusFlangerEngine::writeDelayLine(const SampleType* const* input, int numSamples)
+{
+    auto& state = getAudioState<StorageType>();
+
+    fillRamp(mFeedbackSmoothed, mFeedbackRamp, numSamples);
+
+    // Interleave input + feedback into frames. Each written sample gets the feedback of the previous
+    // delayed sample - the first one comes from the last tile.
+    for (int channel = 0; channel < mNumChannels; channel++) {
+        state.frames[channel] = (StorageType)input[channel][0] + state.feedback[channel];
+    }
+
+    for (int i = 1; i < numSamples; i++) {
+        StorageType* frame = state.frames + i * mNumChannels;
+        const StorageType* previous = state.delayed + (i - 1) * mNumChannels;
+
+        for (int channel = 0; channel < mNumChannels; channel++) {
+            frame[channel] = (StorageType)input[channel][i] + previous[channel] * mFeedbackRamp[i - 1];
+        }
+    }
+
+    const StorageType* last = state.delayed + (numSamples - 1) * mNumChannels;
+
+    for (int channel = 0; channel < mNumChannels; channel++) {
+        state.feedback[channel] = last[channel] * mFeedbackRamp[numSamples - 1];
+    }
+
+    if constexpr (std::is_same<LineType, int16>::value) {
+        packCompactSamples(state.frames, mCompactFrames, numSamples * mNumChannels);
+        state.compactLine.write(mCompactFrames, numSamples);
+    }
+    else {
+        state.delayLine.write(state.frames, numSamples);
+    }
+}
+
+void ChorusFlangerEngine::fillDryWetRamp(int numSamples)
+{
+    fillRamp(mDryWetSmoothed, mDryWetRamp, numSamples);
+
+    // Around a preset switch the whole wet mix is scaled down and back up
+    if (mPresetDuck.isSmoothing() || mPresetDuck.getTargetValue() < 1.0f) {
+        fillRamp(mPresetDuck, mDuckRamp, numSamples);
+        FloatVectorOperations::multiply(mDryWetRamp, mDuckRamp, numSamples);
+    }
+
+    // And around host bypass - fully out, the mix is exactly the dry signal, so the bypassed path takes over cleanly
+    if (mBypassFade.isSmoothing() || mBypassFade.getTargetValue() < 1.0f) {
+        fillRamp(mBypassFade, mDuckRamp, numSamples);
+        FloatVectorOperations::multiply(mDryWetRamp, mDuckRamp, numSamples);
+    }
+}
+
+template <typename SampleType, typename StorageType>
+void ChorusFlangerEngine::mixDryWet(SampleType* const* output, int numSamples)
+{
+    fillDryWetRamp(numSamples);
+
+    // adjust to dry/wet amount: dry * (1 - mix) + wet * mix == dry + mix * (wet - dry)
+    for (int channel = 0; channel < mNumChannels; channel++) {
+        SampleType* out = output[channel];
+        const StorageType* wet = getAudioState<StorageType>().delayed + channel;
+
+        for (int i = 0; i < numSamples; i++) {
+            out[i] += mDryWetRamp[i] * ((SampleType)wet[i * mNumChannels] - out[i]);
+        }
+    }
+}
+
+template <typename SampleType, typename StorageType>
+void ChorusFlangerEngine::copyWet(SampleType* const* output, int numSamples)
+{
+    for (int channel = 0; channel < mNumChannels; channel++) {
+        SampleType* out = output[channel];
+        const StorageType* wet = getAudioState<StorageType>().delayed + channel;
+
+        for (int i = 0; i < numSamples; i++) {
+            out[i] = (SampleType)wet[i * mNumChannels];
+        }
+    }
+}
+
+template <typename SampleType>
+void ChorusFlangerEngine::writeDryDelay(const SampleType* const* input, int numSamples)
+{
+    auto& state = getAudioState<SampleType>();
+
+    // Interleave into frames a tile at a time, the same layout as the main delay line
+    for (int tileStart = 0; tileStart < numSamples; tileStart += MAX_TILE_SIZE) {
+
+        int tileLength = jmin(MAX_TILE_SIZE, numSamples - tileStart);
+
+        for (int i = 0; i < tileLength; i++) {
+            for (int channel = 0; channel < mNumChannels; channel++) {
+                state.frames[i * mNumChannels + channel] = input[channel][tileStart + i];
+            }
+        }
+
+        state.dryDelay.write(state.frames, tileLength);
+    }
+}
+
+template <typename SampleType>
+void ChorusFlangerEngine::mixDelayedDry(SampleType* const* output, int numSamples)
+{
+    const auto& dryDelay = getAudioState<SampleType>().dryDelay;
+
+    // The dry line has just had these numSamples frames written - read them back mDryLatency samples earlier
+    const int firstPosition = dryDelay.getWritePosition() - numSamples - mDryLatency;
+
+    for (int tileStart = 0; tileStart < numSamples; tileStart += MAX_TILE_SIZE) {
+
+        int tileLength = jmin(MAX_TILE_SIZE, numSamples - tileStart);
+
+        fillDryWetRamp(tileLength);
+
+        // adjust to dry/wet amount: dry * (1 - mix) + wet * mix == dry + mix * (wet - dry)
+        for (int i = 0; i < tileLength; i++) {
+            const SampleType* dry = dryDelay.getFrame(firstPosition + tileStart + i);
+
+            for (int channel = 0; channel < mNumChannels; channel++) {
+                SampleType& out = output[channel][tileStart + i];
+                out = dry[channel] + mDryWetRamp[i] * (out - dry[channel]);
+            }
+        }
+    }
+}
+
+template <typename SampleType>
+void ChorusFlangerEngine::copyDelayedDry(SampleType* const* output, int numSamples)
+{
+    const auto& dryDelay = getAudioState<SampleType>().dryDelay;
+    const int firstPosition = dryDelay.getWritePosition() - numSamples - mDryLatency;
+
+    for (int i = 0; i < numSamples; i++) {
+        const SampleType* dry = dryDelay.getFrame(firstPosition + i);
+
+        for (int channel = 0; channel < mNumChannels; channel++) {
+            output[channel][i] = dry[channel];
+        }
+    }
+}
+
@@ -0,0 +1,483 @@
+/*
+  ==============================================================================
+
+    ChorusFlangerEngine.h
+    The chorus/flanger DSP on its own - no AudioProcessor, parameters, presets or editor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "EngineModules.h"
+#include "LFO.h"
+#include "DelayLine.h"
+#include "Interpolators.h"
+#include "Profiler.h"
+
+// Delay time range each effect type sweeps over (seconds)
+# define CHORUS_MIN_DELAY_TIME 0.005f
+# define CHORUS_MAX_DELAY_TIME 0.030f
+# define FLANGER_MIN_DELAY_TIME 0.001f
+# define FLANGER_MAX_DELAY_TIME 0.005f
+
+// Longest delay either type can reach (chorus, 30 ms) - the type can change at any time, so this sizes the delay line
+# define MAX_DELAY_TIME CHORUS_MAX_DELAY_TIME
+
+// Shortest delay either type can reach (flanger, 1 ms). No read head can land on a sample written
+// less than this long ago, so a tile of samples shorter than it never reads what it writes.
+# define MIN_DELAY_TIME FLANGER_MIN_DELAY_TIME
+
+// LFO rate range (Hz) - the rate smoother is multiplicative, so it can't reach 0
+# define MIN_RATE 0.1f
+# define MAX_RATE 20.0f
+
+// Largest feedback amount - at 1 or more the loop never decays, and past it the output grows without limit
+# define MAX_FEEDBACK 0.98f
+
+// Extra samples behind the longest delay that interpolation may touch
+# define INTERPOLATION_MARGIN 2
+
+// Interpolators the interpolation parameter picks from, in parameter order
+# define NUM_INTERPOLATORS 4
+
+// Delay storage precisions the delay precision parameter picks from (32 bit float, 64 bit float, 16 bit)
+# define NUM_DELAY_PRECISIONS 3
+
+// Most channels one instance processes (enough for 7.1.4, 9.1.6 and third order ambisonics)
+# define MAX_CHANNELS 16
+
+// Most chorus voices (modulated taps) per channel - the voices of one channel sit side by side in the
+// per-tile scratch, so up to this many fill the SIMD lanes of one read head
+# define MAX_VOICES 8
+
+// Share of the delay range the voice centres are spread over - the voices stay decorrelated even
+// with the phase offset at zero
+# define VOICE_CENTRE_SPREAD 0.25f
+
+// Highest oversampling order the delay core can run at (2^order times the host rate, so 1x, 2x and 4x)
+# define MAX_OVERSAMPLING_ORDER 2
+
+// Samples per oversampled chunk at the host rate - sizes the oversampling buffers and the dry compensation line
+# define OVERSAMPLING_CHUNK_SIZE 256
+
+// Upper bound on the tile length, sizes the per-tile scratch arrays
+# define MAX_TILE_SIZE 64
+
+// Exact delay times per tap per tile the read heads are fitted through - four, for a cubic
+# define MODULATION_CURVE_POINTS 4
+
+// Time the smoothed parameters take to glide to a new value (seconds)
+# define PARAMETER_SMOOTHING_TIME 0.05
+
+// Level below which the input and the tail count as silence (-100 dBFS)
+# define SILENCE_THRESHOLD 1.0e-5f
+
+// Time a preset switch takes to duck the wet signal out, and again to bring it back (seconds)
+# define PRESET_FADE_TIME 0.01
+
+// Time host bypass takes to fade the wet signal out, and un-bypass to bring it back (seconds)
+# define BYPASS_FADE_TIME 0.02
+
+
+//==============================================================================
+// Every setting of the engine - the plugin's parameters as plain values, with the same ranges and defaults.
+// The engine takes them through limited(), so anything out of range (NaN too) is clamped to the nearest end.
+struct ChorusFlangerParameters
+{
+    float dryWet = 0.5f; // 0 to 1
+    float depth = 0.5f; // 0 to 1
+    float rate = 10.0f; // Hz, MIN_RATE to MAX_RATE
+    float phaseOffset = 0.0f; // 0 to 1
+    float feedback = 0.5f; // 0 to MAX_FEEDBACK
+    int type = 0; // 0 = chorus, 1 = flanger
+    int voices = 1; // chorus voices per channel, 1 to MAX_VOICES
+    int oversampling = 0; // order - 0 = off, 1 = 2x, 2 = 4x
+    int interpolation = 0; // linear, hermite, lagrange, thiran
+    int delayPrecision = 0; // delay storage - 0 = 32 bit, 1 = 64 bit, 2 = 16 bit
+
+    // The same settings clamped to the ranges above, with the switches' counts from the constants
+    ChorusFlangerParameters limited() const;
+
+    bool operator== (const ChorusFlangerParameters& other) const;
+    bool operator!= (const ChorusFlangerParameters& other) const { return ! (*this == other); }
+};
+
+// The settings above, one by one, for scheduled changes
+enum class ChorusFlangerParameterID
+{
+    dryWet,
+    depth,
+    rate,
+    phaseOffset,
+    feedback,
+    type,
+    voices,
+    oversampling,
+    interpolation,
+    delayPrecision
+};
+
+// One parameter change, due at a sample of the block
+struct ChorusFlangerParameterEvent
+{
+    int sampleOffset; // from the start of the block
+    ChorusFlangerParameterID parameter;
+    float value; // plain value, as in ChorusFlangerParameters - rounded for the switches
+};
+
+//==============================================================================
+/**
+    The whole effect behind ChorusFlangerAudioProcessor - the tiled delay core, oversampling, silence detection,
+    bypass and the position-locked LFO - over raw channel pointers, so it can be embedded without the plugin
+    framework. It only needs juce_core, juce_audio_basics and juce_dsp.
+
+    prepare and release allocate and free. setParameters, process, seek and reset never do, and are meant for
+    the one thread that processes. prepare reserves the delay memory for every oversampling order and storage
+    precision at the host rate, so either can change while playing.
+*/
+class ChorusFlangerEngine
+{
+public:
+    ChorusFlangerEngine();
+
+    //==============================================================================
+    // Builds the filters in the given host precision (process in the other one leaves the audio dry) and reserves
+    // the delay memory. Starts at position 0 with the parameters as set, without gliding to them.
+    void prepare(double sampleRate, int maximumBlockSize, int numChannels, bool doublePrecision = false);
+
+    // Frees the delay memory and the filters
+    void release();
+
+    // Silences the delay lines, feedback and filters and goes back to position 0, with the parameters jumped to
+    void reset();
+
+    // Taken at the start of the next block and glided to - call between blocks, from the thread that processes
+    void setParameters(const ChorusFlangerParameters& parameters) { mParameters = parameters.limited(); }
+    const ChorusFlangerParameters& getParameters() const { return mParameters; }
+
+    //==============================================================================
+    // Processes numChannels channels in place. Bypassed, the wet signal fades out, then only what BypassMode
+    // asks for keeps running.
+    void process(float* const* channels, int numChannels, int numSamples, bool bypassed = false);
+    void process(double* const* channels, int numChannels, int numSamples, bool bypassed = false);
+
+    // The same with parameter changes at exact samples. The events must be sorted by ascending sampleOffset
+    // (debug builds assert it) - one out of order is taken late, with the change before it. The block runs in
+    // stretches between the changes, and each change glides in from its sample as it would from the start of a
+    // block. Changes at or past numSamples are taken after the block. Values are clamped as by setParameters, and
+    // an event for an unknown parameter is ignored.
+    void process(float* const* channels, int numChannels, int numSamples,
+                 const ChorusFlangerParameterEvent* events, int numEvents, bool bypassed = false);
+    void process(double* const* channels, int numChannels, int numSamples,
+                 const ChorusFlangerParameterEvent* events, int numEvents, bool bypassed = false);
+
+    // Latency of the oversampling filters at the current order, in host rate samples - the dry signal is held
+    // back by the same amount
+    int getLatencySamples() const { return mDryLatency; }
+
+    // Worst case time for the tail to decay into silence, for the engine's parameters or any others
+    double getTailLengthSeconds() const { return getTailLengthSeconds(mParameters); }
+    double getTailLengthSeconds(const ChorusFlangerParameters& parameters) const;
+
+    //==============================================================================
+    // Selects the LFO back end (see LFO::Mode), takes effect on the next prepare
+    void setLFOMode(LFO::Mode mode, int controlRateInterval = 1);
+
+    // What keeps running while bypassed, once the wet signal has faded out
+    enum class BypassMode
+    {
+        keepFed, // the input keeps going into the delay line while it isn't silent, so un-bypass picks up with a full line
+        sleep // nothing but the latency compensation - un-bypass waits for the line to refill before fading in
+    };
+
+    void setBypassMode(BypassMode mode) { mBypassMode.store(mode, std::memory_order_relaxed); }
+
+    //==============================================================================
+    /* Position - a host rate sample count from 0 at prepare. While the rate holds still the LFO phase is a
+       function of the position alone, so a render can start anywhere and line up with one that ran from the top. */
+
+    // Moves the position of the next block - call between blocks, from the thread that processes
+    void seek(juce::int64 samplePosition);
+    juce::int64 getSamplePosition() const { return mSamplePosition; }
+
+    // Runs the input that leads up to position through the engine, throwing the output away, and leaves it at
+    // position - the delay line, feedback and filters then hold what a run from the start would, as far back as
+    // the history reaches. The parameters settle first. Allocates, so not for the audio thread.
+    void prime(const float* const* history, int numChannels, int numSamples, juce::int64 position);
+    void prime(const double* const* history, int numChannels, int numSamples, juce::int64 position);
+
+    //==============================================================================
+    /* Switching a whole set of parameters at once (a preset) - duck the wet signal out, wait until it is out,
+       jump to the new parameters, and bring it back */
+    void duckOut();
+    bool isDuckedOut() const; // asleep and bypassed count as out
+    void jumpToParameters(const ChorusFlangerParameters& parameters); // sets them and ends all smoothing
+    void duckIn();
+
+    //==============================================================================
+    // State for a display, as of the last block
+    double getLFOPhase() const { return mLFO.getPhase(); }
+    float getDelayTimeMs(int channel) const; // the channel's first voice
+
+    // Stage timings of the processing thread - only recorded in profiling builds (CHORUSFLANGER_PROFILING)
+    Profiler& getProfiler() { return mProfiler; }
+
+    //==============================================================================
+    /* Read heads - the delay times are worked out exactly at a few samples of each tile only, and the read heads
+       follow the cubic through them as fixed point accumulators. StreamBank moves its read heads the same way. */
+
+    // Samples of a numSamples tile the cubic goes through (MODULATION_CURVE_POINTS, or every sample of a shorter
+    // tile) - returns how many
+    static int getModulationCurvePoints(int numSamples, int* points);
+
+    // Fits the cubic through the exact delay times at those samples (curve is overwritten), and gives the
+    // accumulators' starting values - the delay time at the tile's first sample, then its forward differences
+    static void fitModulationCurve(double* curve, const int* points, int numPoints, juce::int64* differences);
+
+private:
+
+    /* Everything that holds audio, once per precision. The delay core works in the precision of its delay
+       storage, the oversampling filters and the dry compensation line in the host's. */
+    template <typename SampleType>
+    struct AudioState
+    {
+        DelayLine<SampleType> delayLine; // interleaved frames, one sample per channel
+        DelayLine<int16> compactLine; // the same in 16 bits, for the compact precision - only the float state's is used
+        SampleType feedback[MAX_CHANNELS]; // feedback carried into the next written sample
+        SampleType interpolatorState[MAX_CHANNELS * MAX_VOICES]; // one value per tap, for interpolators that keep state (Thiran)
+
+        // Per-tile scratch, one entry per tap per sample - [(sample * channels + channel) * voices + voice].
+        // Allocated in prepare for the prepared channel count, in both states since the storage precision can change.
+        HeapBlock<SampleType> taps; // interpolated output of every voice
+        HeapBlock<SampleType> points; // gathered interpolation points, oldest first - MAX_INTERPOLATION_POINTS runs of a tile's taps
+
+        // Per-tile scratch, one entry per sample per channel (interleaved frames)
+        HeapBlock<SampleType> delayed; // delay line output, voices summed
+        HeapBlock<SampleType> frames; // input + feedback on its way into the delay line, or the dry signal into dryDelay
+
+        /* Oversampling - one set of half-band filters per order, all built in prepare so switching never allocates */
+        std::unique_ptr<dsp::Oversampling<SampleType>> oversampling[MAX_OVERSAMPLING_ORDER];
+        DelayLine<SampleType> dryDelay; // holds the dry signal back by the oversampling latency
+
+        // The line the core stores in - delayLine, or compactLine for 16-bit storage
+        template <typename LineType>
+        DelayLine<LineType>& getDelayLine()
+        {
+            if constexpr (std::is_same<LineType, int16>::value) {
+                return compactLine;
+            }
+            else {
+                return delayLine;
+            }
+        }
+
+        void clearCore(); // silences the delay lines, the feedback and the interpolator state
+        void clearLoop(); // silences only the feedback and the interpolator state
+        void releaseHostPrecision(); // frees the filters and the dry line when the host runs at the other precision
+
+        // Allocates the tile scratch for numChannels
+        void allocateScratch(int numChannels);
+        void releaseScratch();
+    };
+
+    template <typename SampleType>
+    AudioState<SampleType>& getAudioState()
+    {
+        if constexpr (std::is_same<SampleType, double>::value) {
+            return mDoubleState;
+        }
+        else {
+            return mFloatState;
+        }
+    }
+
+    void clearInterpolatorState(); // both precisions - a new interpolator or tap layout can't use the old state
+
+    // process for either host precision - splits the block at the events and runs processBlock over each stretch
+    template <typename SampleType>
+    void processEvents(SampleType* const* channels, int numChannels, int numSamples,
+                       const ChorusFlangerParameterEvent* events, int numEvents, bool bypassed);
+
+    // One stretch of samples with a single parameter snapshot
+    template <typename SampleType>
+    void processBlock(SampleType* const* channels, int numChannels, int numSamples, bool bypassed);
+
+    static void applyEvent(ChorusFlangerParameters& parameters, const ChorusFlangerParameterEvent& event); // clamped
+
+    void updateParameterSnapshot(); // reads the parameters once per block
+
+    static int getDelayLineLength(double sampleRate); // frames needed at a given sample rate
+
+    // Sets the delay core up to run at 2^order times the host rate - never allocates, so it can run on the audio thread
+    void prepareCore(int oversamplingOrder);
+
+    // Builds the oversampling filters and the dry compensation line in the host's precision
+    template <typename SampleType>
+    void prepareHostPrecision(AudioState<SampleType>& state);
+
+    // Clears the dry line and the filters for an order, and returns their latency in host rate samples
+    template <typename SampleType>
+    int resetHostFilters(AudioState<SampleType>& state, int oversamplingOrder);
+
+    // Runs the delay core over numSamples samples at the core rate. With mixDry the output is the dry/wet mix,
+    // otherwise it is the wet signal only (the oversampled path mixes afterwards, at the host rate).
+    template <typename SampleType>
+    void processCore(SampleType* const* channels, int numSamples, bool mixDry);
+
+    // processCore computing in StorageType, with the delay line holding LineType (StorageType, or int16 for
+    // compact storage) - picks the tile processor for the interpolator and type
+    template <typename SampleType, typename StorageType, typename LineType>
+    void processCoreIn(SampleType* const* channels, int numSamples, bool mixDry);
+
+    // processCore for one host precision, storage precision, interpolator and effect type - compiled once for
+    // each combination, so the tile loops never branch on any of them
+    template <typename SampleType, typename StorageType, typename LineType, typename Interpolator, bool isChorus>
+    void processTiles(SampleType* const* channels, int numSamples, bool mixDry);
+
+    // Runs the delay core oversampled, with the dry signal delayed to line up with the filtered wet signal
+    template <typename SampleType>
+    void processOversampled(SampleType* const* channels, int numChannels, int numSamples);
+
+    /* Silence detection - once the input and everything circulating in the delay line are below SILENCE_THRESHOLD,
+       blocks pass through dry without touching the core until the input comes back */
+    void skipSilentBlock(int numSamples); // keeps the parameters and LFO moving while asleep
+    template <typename SampleType>
+    void wakeUp(); // starts the core again from a clean state
+
+    /* Bypass - once the fade is down the core stops. The input is written straight into the delay line, with no
+       modulation, interpolation or feedback, and the output is the (latency compensated) dry signal. */
+    template <typename SampleType>
+    void processBypassed(SampleType* const* channels, int numChannels, int numSamples, bool inputSilent);
+    template <typename SampleType>
+    void feedCore(const SampleType* const* input, int numSamples); // host rate input -> delay line, at the core rate
+    template <typename SampleType, typename StorageType, typename LineType>
+    void feedDelayLine(const SampleType* const* input, int numSamples);
+    template <typename SampleType>
+    void leaveBypass(); // restarts the feedback, read heads and filters, keeping the line and the dry line
+
+    /* Position */
+    void syncLFO(); // puts the LFO at the phase of the block's position, or anchors it there while the rate moves
+    double getLFOPhaseAt(juce::int64 position) const; // from the anchor, at the anchor's rate
+    template <typename SampleType>
+    void primeFrom(const SampleType* const* history, int numChannels, int numSamples, juce::int64 position);
+
+    void jumpToTargets(); // ends all parameter smoothing at once
+    void fillDryWetRamp(int numSamples); // smoothed dry/wet, with any preset duck and bypass fade applied
+
+    /* Tile stages - each one runs over a whole tile of samples at once. Per-channel scratch is laid out
+       as interleaved frames (sample-major), so all channels of one sample sit next to each other. */
+    void updateVoiceLayout(float phaseOffset); // per-tap LFO rotations, centres and sweeps
+    template <bool isChorus>
+    void generateModulation(int numSamples); // LFO -> delay times in samples
+    template <typename StorageType, typename LineType, typename Interpolator, bool isChorus>
+    void readDelayLine(int numSamples); // read heads + interpolation -> delayed samples
+    template <typename SampleType, typename StorageType, typename LineType>
+    void writeDelayLine(const SampleType* const* input, int numSamples); // input + feedback -> circular buffer
+    template <typename SampleType, typename StorageType>
+    void mixDryWet(SampleType* const* output, int numSamples); // dry/wet blend into the output
+    template <typename SampleType, typename StorageType>
+    void copyWet(SampleType* const* output, int numSamples); // wet signal only into the output
+
+    /* Oversampled path stages - these run at the host rate */
+    template <typename SampleType>
+    void writeDryDelay(const SampleType* const* input, int numSamples); // dry input -> latency compensation line
+    template <typename SampleType>
+    void copyDelayedDry(SampleType* const* output, int numSamples); // latency compensation line only into the output
+    template <typename SampleType>
+    void mixDelayedDry(SampleType* const* output, int numSamples); // blends the wet output with the delayed dry signal
+
+    /* Parameters - as last set, read into the snapshot at the start of every block */
+    ChorusFlangerParameters mParameters;
+
+    /* Parameter snapshot - taken once per block, ramped per sample to avoid zipper noise */
+    SmoothedValue<float> mDryWetSmoothed;
+    SmoothedValue<float> mDepthSmoothed;
+    SmoothedValue<float, ValueSmoothingTypes::Multiplicative> mRateSmoothed; // rate is perceived logarithmically
+    SmoothedValue<float> mPhaseOffsetSmoothed;
+    SmoothedValue<float> mFeedbackSmoothed;
+    int mType;
+    int mNumVoices; // voices per channel this block - always 1 for the flanger
+    int mInterpolation; // interpolator this block, index into the processTiles table
+    int mDelayPrecision; // delay storage precision the core is currently set up for
+
+    double mSampleRate;
+    double mCoreSampleRate; // rate the delay core runs at - the host rate times the oversampling factor
+    int mMaximumBlockSize;
+    bool mDoublePrecision; // the host precision the filters and dry line are built for
+
+    /* Audio state - the delay lines of every storage precision are reserved in prepare for the highest
+       oversampling order, so either can change while playing without allocating. The filters are only built
+       for the host's precision. */
+    AudioState<float> mFloatState;
+    AudioState<double> mDoubleState;
+
+    int mOversamplingOrder; // order the core is currently set up for
+    int mDryLatency; // in host rate samples, 0 when not oversampling
+
+    /* Silence detection */
+    bool mSleeping; // the core is idle and blocks pass through untouched
+    int mQuietSamples; // host rate samples since the input or the wet signal last reached SILENCE_THRESHOLD
+    int mSleepAfterSamples; // quiet samples before sleeping - by then nothing a read head or filter can reach is audible
+    float mWetPeak; // loudest wet sample in the current block
+
+    /* Parameter switching */
+    SmoothedValue<float> mPresetDuck; // gain on the wet mix, 1 except around a switch
+
+    /* Bypass */
+    std::atomic<BypassMode> mBypassMode;
+    SmoothedValue<float> mBypassFade; // gain on the wet mix, heading for 0 while bypassed
+    bool mBypassed; // faded out - the core is stopped, and only fed or asleep
+    int mBypassRefillSamples; // host rate samples before the wet signal can fade back in, after a sleeping bypass
+
+    Profiler mProfiler; // there in every build, so the layout doesn't depend on CHORUSFLANGER_PROFILING
+
+    int mNumChannels; // delay line channels
+
+    /* LFO Data */
+    LFO mLFO;
+    LFO::Mode mLFOMode;
+    int mLFOControlRateInterval;
+
+    // The phase at every position follows from the anchor while the rate stays at the anchor's rate. A rate
+    // change moves the anchor along with the LFO until the rate settles, then leaves it at the new rate.
+    juce::int64 mSamplePosition; // host rate position of the next block's first sample
+    juce::int64 mLFOAnchorPosition;
+    double mLFOAnchorPhase; // in cycles
+    float mLFOAnchorRate; // -1 while the rate is gliding
+
+    // Each tap (one voice of one channel) is the LFO rotated by its channel's share of the phase offset plus
+    // its voice's share of the cycle - rotations cached until the offset, voice count or type moves.
+    // Indexed [channel * mNumVoices + voice].
+    float mPhaseOffsetRotated;
+    int mVoiceLayoutVoices;
+    int mVoiceLayoutType;
+    float mPhaseOffsetCos[MAX_CHANNELS * MAX_VOICES];
+    float mPhaseOffsetSin[MAX_CHANNELS * MAX_VOICES];
+    float mVoiceCentre[MAX_CHANNELS * MAX_VOICES]; // delay centre in samples
+    float mVoiceSweep[MAX_CHANNELS * MAX_VOICES]; // share of the full sweep left around that centre
+    float mVoiceGain; // 1 / voices, keeps the feedback loop gain below one
+
+    /* Tile Data */
+    int mTileSize; // number of samples processed per tile, always shorter than the minimum delay
+
+    // Per-tile scratch, one entry per sample in the tile
+    float mLFOSin[MAX_TILE_SIZE]; // quadrature LFO output
+    float mLFOCos[MAX_TILE_SIZE];
+    float mDepthRamp[MAX_TILE_SIZE]; // smoothed parameter values for each sample
+    float mFeedbackRamp[MAX_TILE_SIZE];
+    float mDryWetRamp[MAX_TILE_SIZE];
+    float mDuckRamp[MAX_TILE_SIZE];
+
+    // Per-tile scratch, one entry per tap per sample - [(sample * channels + channel) * voices + voice]. Allocated
+    // in prepare for the prepared channel count and every voice, since the voice count can change while playing.
+    HeapBlock<int64> mDelayTime; // delay times in samples, fixed point (DELAY_TIME_FRACTION_BITS)
+    HeapBlock<int> mReadOffset; // whole samples part of the read heads
+    HeapBlock<float> mReadFrac; // fractional part of the read heads
+
+    // Per-tile scratch, one entry per sample per channel
+    HeapBlock<int16> mCompactFrames; // the frames packed for 16-bit storage
+
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ChorusFlangerEngine)
+};
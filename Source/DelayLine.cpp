@@ -0,0 +1,124 @@
+/*
+  ==============================================================================
+
+    DelayLine.cpp
+    Circular delay memory shared by all channels, laid out for branchless reads.
+
+  ==============================================================================
+*/
+
+#include "DelayLine.h"
+
+//==============================================================================
+template <typename SampleType>
+DelayLine<SampleType>::DelayLine()
+{
+    mCapacity = 0;
+    mNumChannels = 0;
+    mLength = 0;
+    mMask = 0;
+    mWritePosition = 0;
+}
+
+// Samples needed to hold a power-of-two length line plus its guard frames
+static size_t getNumSamplesNeeded(int numChannels, int length)
+{
+    return (size_t)(length + DELAY_LINE_GUARD_FRAMES) * (size_t)numChannels;
+}
+
+static int roundLength(int minimumLength)
+{
+    return nextPowerOfTwo(jmax(minimumLength, DELAY_LINE_GUARD_FRAMES));
+}
+
+template <typename SampleType>
+void DelayLine<SampleType>::reserve(int numChannels, int maximumLength)
+{
+    size_t numSamples = getNumSamplesNeeded(numChannels, roundLength(maximumLength));
+
+    if (numSamples > mCapacity) {
+        mData.allocate(numSamples, false);
+        mCapacity = numSamples;
+    }
+}
+
+template <typename SampleType>
+void DelayLine<SampleType>::setSize(int numChannels, int minimumLength)
+{
+    int length = roundLength(minimumLength);
+
+    reserve(numChannels, length);
+
+    mNumChannels = numChannels;
+    mLength = length;
+    mMask = length - 1;
+
+    clear();
+}
+
+template <typename SampleType>
+void DelayLine<SampleType>::clear()
+{
+    if (mData != nullptr) {
+        zeromem(mData.get(), getNumSamplesNeeded(mNumChannels, mLength) * sizeof(SampleType));
+    }
+    mWritePosition = 0;
+}
+
+template <typename SampleType>
+void DelayLine<SampleType>::release()
+{
+    mData.free();
+    mCapacity = 0;
+    mNumChannels = 0;
+    mLength = 0;
+    mMask = 0;
+    mWritePosition = 0;
+}
+
+//==============================================================================
+template <typename SampleType>
+void DelayLine<SampleType>::write(const SampleType* frames, int numFrames)
+{
+    // Copy in up to the end of the line, then carry on from the start
+    int firstPart = jmin(numFrames, mLength - mWritePosition);
+    int secondPart = numFrames - firstPart;
+
+    memcpy(mData.get() + mWritePosition * mNumChannels, frames, (size_t)(firstPart * mNumChannels) * sizeof(SampleType));
+
+    if (secondPart > 0) {
+        memcpy(mData.get(), frames + firstPart * mNumChannels, (size_t)(secondPart * mNumChannels) * sizeof(SampleType));
+    }
+
+    // Refresh the mirrored guard frames if the head of the line was written
+    bool wroteHead = (mWritePosition < DELAY_LINE_GUARD_FRAMES) || (secondPart > 0);
+
+    mWritePosition = (mWritePosition + numFrames) & mMask;
+
+    if (wroteHead) {
+        memcpy(mData.get() + mLength * mNumChannels, mData.get(), (size_t)(DELAY_LINE_GUARD_FRAMES * mNumChannels) * sizeof(SampleType));
+    }
+}
+
+//==============================================================================
+void packCompactSamples(const float* source, int16* dest, int numSamples)
+{
+    const float scale = 32767.0f / COMPACT_DELAY_HEADROOM;
+
+    // Clamp and truncate, which rounds toward zero - rounding to nearest would leave the last few steps of a
+    // feedback tail circulating forever (0.98 of 25 rounds back up to 25), so the line never fell silent. No
+    // branches or rounding mode calls, so it packs a vector at a time (std::min/max in this order map straight
+    // onto minps/maxps). The clamp lets NaN through, and converting that is undefined - it packs as silence
+    // instead (a compare and a mask, still no branch).
+    for (int i = 0; i < numSamples; i++) {
+        const float sample = (source[i] == source[i]) ? source[i] : 0.0f;
+        float value = std::min(std::max(sample * scale, -32767.0f), 32767.0f);
+        dest[i] = (int16)(int)value;
+    }
+}
+
+//==============================================================================
+// The storage precisions the delay core and the dry compensation line use
+template class DelayLine<float>;
+template class DelayLine<double>;
+template class DelayLine<int16>;
@@ -0,0 +1,87 @@
+/*
+  ==============================================================================
+
+    DelayLine.h
+    Circular delay memory shared by all channels, laid out for branchless reads.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "EngineModules.h"
+
+// Frames mirrored past the end of the line, so an interpolator up to this many points wide
+// can read straight through the wrap point
+# define DELAY_LINE_GUARD_FRAMES 4
+
+// Level that fills the range of 16-bit delay storage (+12 dB) - room for feedback to build up above full scale.
+// Anything louder is clipped to it on the way in.
+# define COMPACT_DELAY_HEADROOM 4.0f
+
+//==============================================================================
+// 16-bit delay storage - floats scaled so COMPACT_DELAY_HEADROOM fills the int16 range
+inline float unpackCompactSample(int16 sample)
+{
+    return (float)sample * (COMPACT_DELAY_HEADROOM / 32767.0f);
+}
+
+// Packs numSamples floats, rounding toward zero (so a decaying tail reaches silence) and saturating, so a runaway
+// feedback loop clips instead of wrapping around
+void packCompactSamples(const float* source, int16* dest, int numSamples);
+
+//==============================================================================
+/**
+    Multichannel circular buffer with a power-of-two length, storing float, double or 16-bit samples.
+
+    Samples are stored as interleaved frames (L R L R ... for stereo), so the read heads of all
+    channels at one delay time land on the same cache line. Positions wrap with a mask instead of
+    a compare and branch, and the first DELAY_LINE_GUARD_FRAMES frames are mirrored after the last
+    one - any interpolation window starting inside the line is contiguous in memory.
+*/
+template <typename SampleType>
+class DelayLine
+{
+public:
+    DelayLine();
+
+    //==============================================================================
+    // Makes sure storage for at least maximumLength frames is allocated, never shrinks it
+    void reserve(int numChannels, int maximumLength);
+
+    // Sets the live length to at least minimumLength frames (rounded up to a power of two) and clears it.
+    // Only allocates if the reserved storage is too small.
+    void setSize(int numChannels, int minimumLength);
+
+    // Clears the live frames only - the rest of the reserved storage is never read
+    void clear();
+
+    // Frees the storage
+    void release();
+
+    int getNumChannels() const { return mNumChannels; }
+    int getLength() const { return mLength; }
+    int getMask() const { return mMask; }
+
+    // Frame the next write goes to
+    int getWritePosition() const { return mWritePosition; }
+
+    //==============================================================================
+    // Frame at any position (wrapped with the mask) - the DELAY_LINE_GUARD_FRAMES frames after it follow contiguously
+    const SampleType* getFrame(int position) const { return mData.get() + (position & mMask) * mNumChannels; }
+
+    // Appends numFrames interleaved frames and moves the write position on
+    void write(const SampleType* frames, int numFrames);
+
+private:
+    HeapBlock<SampleType> mData; // mCapacity samples, of which the first (mLength + DELAY_LINE_GUARD_FRAMES) * mNumChannels are live
+    size_t mCapacity;
+
+    int mNumChannels;
+    int mLength; // in frames, power of two
+    int mMask; // mLength - 1
+    int mWritePosition;
+
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DelayLine)
+};
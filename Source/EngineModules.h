@@ -0,0 +1,22 @@
+/*
+  ==============================================================================
+
+    EngineModules.h
+    The JUCE modules the engine is written against, headers only.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+// The engine sources include this rather than JuceHeader.h, so the engine library can be built without a module
+// list of its own - it carries no JUCE code, and the plugin or tool it is linked into compiles the modules once.
+// Whatever includes it gets the module settings from the same compiler defines as the code it links with.
+#include <juce_core/juce_core.h>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <juce_dsp/juce_dsp.h>
+
+#if ! DONT_SET_USING_JUCE_NAMESPACE
+ using namespace juce;
+#endif
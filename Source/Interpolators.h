@@ -0,0 +1,204 @@
+/*
+  ==============================================================================
+
+    Interpolators.h
+    Fractional delay interpolators the delay core is specialised over.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "EngineModules.h"
+
+// Most points any interpolator reads per tap
+# define MAX_INTERPOLATION_POINTS 4
+
+// Most points newer than the whole-sample delay any interpolator reads - the tile is shortened by this
+// many samples so those points are always written by an earlier tile
+# define INTERPOLATION_LOOKAHEAD 1
+
+// Fraction bits of a fixed point delay time - 32.32, so a read head resolves far finer than a float delay
+// time does once it is thousands of samples long
+# define DELAY_TIME_FRACTION_BITS 32
+
+//==============================================================================
+// Delay time in samples to fixed point and back
+inline int64 toFixedDelayTime(double delayTime)
+{
+    return (int64)std::llround(delayTime * (double)((int64)1 << DELAY_TIME_FRACTION_BITS));
+}
+
+inline double fromFixedDelayTime(int64 delayTime)
+{
+    return (double)delayTime / (double)((int64)1 << DELAY_TIME_FRACTION_BITS);
+}
+
+// Whole samples and fraction of a fixed point delay time - a shift and a mask, no float to int conversion.
+// The fraction keeps its top 24 bits, which is all a float holds.
+inline void splitFixedDelayTime(int64 delayTime, int& delay, float& frac)
+{
+    const int64 fractionMask = ((int64)1 << DELAY_TIME_FRACTION_BITS) - 1;
+
+    delay = (int)(delayTime >> DELAY_TIME_FRACTION_BITS);
+    frac = (float)(int)((delayTime & fractionMask) >> (DELAY_TIME_FRACTION_BITS - 24)) * (1.0f / (float)(1 << 24));
+}
+
+//==============================================================================
+/*
+    Each interpolator is a set of static functions, so the delay core can be compiled once per
+    interpolator with everything inlined and no branch on the mode left in the loops.
+
+    A read head at d + frac samples sits between the whole-sample points d and d + 1 (frac runs from d
+    towards d + 1). An interpolator reads numPoints consecutive points, the oldest firstPointDelay
+    samples back from d, and gets them as separate arrays - points[0] is the oldest - with one entry per
+    tap in the tile.
+
+    split() turns a fixed point delay time into d and frac (some interpolators prefer frac in a different range),
+    and process() runs over every tap in the tile. Taps are sample-major, numTaps per sample, and
+    state holds one value per tap for the interpolators that need it. Points, output and state are in the
+    delay storage precision (float or double) - the fractions are always float.
+*/
+
+// Two points, first order - cheapest, but dulls the top end as frac moves away from 0
+struct LinearInterpolator
+{
+    static constexpr int numPoints = 2;
+    static constexpr int firstPointDelay = 1;
+    static constexpr int numNewerPoints = 0;
+
+    static void split(int64 delayTime, int& delay, float& frac)
+    {
+        splitFixedDelayTime(delayTime, delay, frac);
+    }
+
+    template <typename SampleType>
+    static void process(SampleType* const* points, const float* frac, SampleType* out, int numSamples, int numTaps, SampleType* state)
+    {
+        ignoreUnused(state);
+        const int numValues = numSamples * numTaps;
+
+        const SampleType* older = points[0];
+        const SampleType* newer = points[1];
+
+        // x + frac * (x_older - x), all taps at once
+        for (int k = 0; k < numValues; k++) {
+            out[k] = newer[k] + frac[k] * (older[k] - newer[k]);
+        }
+    }
+};
+
+// Four points, third order Hermite (Catmull-Rom) - smooth first derivative, a good default for modulation
+struct CubicHermiteInterpolator
+{
+    static constexpr int numPoints = 4;
+    static constexpr int firstPointDelay = 2;
+    static constexpr int numNewerPoints = 1;
+
+    static void split(int64 delayTime, int& delay, float& frac)
+    {
+        splitFixedDelayTime(delayTime, delay, frac);
+    }
+
+    template <typename SampleType>
+    static void process(SampleType* const* points, const float* frac, SampleType* out, int numSamples, int numTaps, SampleType* state)
+    {
+        ignoreUnused(state);
+        const int numValues = numSamples * numTaps;
+
+        // Points in the direction frac runs: y(-1) is the newest, y(2) the oldest
+        const SampleType* y2 = points[0];
+        const SampleType* y1 = points[1];
+        const SampleType* y0 = points[2];
+        const SampleType* ym1 = points[3];
+
+        for (int k = 0; k < numValues; k++) {
+            const SampleType t = frac[k];
+            const SampleType c1 = SampleType(0.5) * (y1[k] - ym1[k]);
+            const SampleType c2 = ym1[k] - SampleType(2.5) * y0[k] + SampleType(2) * y1[k] - SampleType(0.5) * y2[k];
+            const SampleType c3 = SampleType(0.5) * (y2[k] - ym1[k]) + SampleType(1.5) * (y0[k] - y1[k]);
+
+            out[k] = ((c3 * t + c2) * t + c1) * t + y0[k];
+        }
+    }
+};
+
+// Four points, third order Lagrange - flattest passband of the polynomial ones, slightly more ripple in between
+struct LagrangeInterpolator
+{
+    static constexpr int numPoints = 4;
+    static constexpr int firstPointDelay = 2;
+    static constexpr int numNewerPoints = 1;
+
+    static void split(int64 delayTime, int& delay, float& frac)
+    {
+        splitFixedDelayTime(delayTime, delay, frac);
+    }
+
+    template <typename SampleType>
+    static void process(SampleType* const* points, const float* frac, SampleType* out, int numSamples, int numTaps, SampleType* state)
+    {
+        ignoreUnused(state);
+        const int numValues = numSamples * numTaps;
+
+        const SampleType* y2 = points[0];
+        const SampleType* y1 = points[1];
+        const SampleType* y0 = points[2];
+        const SampleType* ym1 = points[3];
+
+        // Lagrange basis through the points at -1, 0, 1 and 2, evaluated at t
+        for (int k = 0; k < numValues; k++) {
+            const SampleType t = frac[k];
+            const SampleType tp1 = t + 1;
+            const SampleType tm1 = t - 1;
+            const SampleType tm2 = t - 2;
+            const SampleType sixth = SampleType(1) / 6;
+
+            out[k] = -t * tm1 * tm2 * sixth * ym1[k]
+                   + tp1 * tm1 * tm2 * SampleType(0.5) * y0[k]
+                   - tp1 * t * tm2 * SampleType(0.5) * y1[k]
+                   + tp1 * t * tm1 * sixth * y2[k];
+        }
+    }
+};
+
+// First order Thiran allpass - flat magnitude at every frac, so the top end never dulls, at the cost of
+// a little phase smear while the delay moves. Keeps one output per tap between calls.
+struct ThiranInterpolator
+{
+    static constexpr int numPoints = 2;
+    static constexpr int firstPointDelay = 1;
+    static constexpr int numNewerPoints = 1; // split() can move the read head one sample newer
+
+    static void split(int64 delayTime, int& delay, float& frac)
+    {
+        splitFixedDelayTime(delayTime, delay, frac);
+
+        // The allpass is best behaved with frac between 0.618 and 1.618
+        if (frac < 0.618f && delay >= 1) {
+            delay--;
+            frac += 1.0f;
+        }
+    }
+
+    template <typename SampleType>
+    static void process(SampleType* const* points, const float* frac, SampleType* out, int numSamples, int numTaps, SampleType* state)
+    {
+        const SampleType* older = points[0];
+        const SampleType* newer = points[1];
+
+        // Each output feeds the next sample of the same tap, so the loop runs across taps, not samples
+        for (int i = 0; i < numSamples; i++) {
+            const int first = i * numTaps;
+
+            for (int tap = 0; tap < numTaps; tap++) {
+                const int k = first + tap;
+                const SampleType f = frac[k];
+                const SampleType alpha = (1 - f) / (1 + f);
+
+                out[k] = older[k] + alpha * (newer[k] - state[tap]);
+                state[tap] = out[k];
+            }
+        }
+    }
+};
@@ -0,0 +1,292 @@
+/*
+  ==============================================================================
+
+    LFO.cpp
+    Sine LFO that sweeps the delay times, with a choice of cheap back ends.
+
+  ==============================================================================
+*/
+
+#include "LFO.h"
+
+//==============================================================================
+LFO::LFO()
+{
+    mSampleRate = 44100.0;
+    mMode = Mode::quadrature;
+    mControlRateInterval = 1;
+
+    mFrequency = 1.0f;
+    mPhase = 0;
+    mPhaseIncrement = 0;
+
+    mRotorCos = 1;
+    mRotorSin = 0;
+    mStepCos = 1;
+    mStepSin = 0;
+    mIntervalCos = 1;
+    mIntervalSin = 0;
+
+    mKeyPhase = 0;
+    mKeySin = 0;
+    mKeyCos = 1;
+    mSegmentSin = 0;
+    mSegmentCos = 1;
+    mSegmentSinStep = 0;
+    mSegmentCosStep = 0;
+    mSegmentRemaining = 0;
+
+    updateCoefficients();
+}
+
+const float* LFO::getSineTable()
+{
+    // Built once on first use and then only ever read, so every instance can share it
+    struct SineTable
+    {
+        SineTable()
+        {
+            for (int i = 0; i <= LFO_TABLE_SIZE; i++) {
+                data[i] = (float)std::sin(MathConstants<double>::twoPi * i / LFO_TABLE_SIZE);
+            }
+        }
+
+        float data[LFO_TABLE_SIZE + 1];
+    };
+
+    static const SineTable table;
+    return table.data;
+}
+
+//==============================================================================
+void LFO::prepare(double sampleRate)
+{
+    mSampleRate = sampleRate;
+    updateCoefficients();
+    reset();
+}
+
+void LFO::reset(double phase)
+{
+    mPhase = phase - std::floor(phase);
+
+    resyncRotor(mPhase);
+
+    mKeyPhase = mPhase;
+    evaluate(mKeyPhase, mKeySin, mKeyCos);
+    mSegmentRemaining = 0;
+}
+
+void LFO::setMode(Mode newMode)
+{
+    mMode = newMode;
+    reset(mPhase);
+}
+
+void LFO::setControlRateInterval(int numSamples)
+{
+    mControlRateInterval = jmax(1, numSamples);
+    updateCoefficients();
+    reset(mPhase);
+}
+
+void LFO::setFrequency(float frequencyHz)
+{
+    if (frequencyHz == mFrequency) {
+        return;
+    }
+
+    mFrequency = frequencyHz;
+    updateCoefficients();
+}
+
+void LFO::updateCoefficients()
+{
+    mPhaseIncrement = mFrequency / mSampleRate;
+
+    const double stepAngle = MathConstants<double>::twoPi * mPhaseIncrement;
+    mStepCos = (float)std::cos(stepAngle);
+    mStepSin = (float)std::sin(stepAngle);
+    mIntervalCos = (float)std::cos(stepAngle * mControlRateInterval);
+    mIntervalSin = (float)std::sin(stepAngle * mControlRateInterval);
+}
+
+//==============================================================================
+void LFO::process(float* sinOut, float* cosOut, int numSamples)
+{
+    if (mControlRateInterval > 1) {
+        renderControlRate(sinOut, cosOut, numSamples);
+    }
+    else {
+        renderAudioRate(sinOut, cosOut, numSamples);
+    }
+}
+
+void LFO::renderAudioRate(float* sinOut, float* cosOut, int numSamples)
+{
+    switch (mMode)
+    {
+        case Mode::sine:
+        {
+            for (int i = 0; i < numSamples; i++) {
+                sinOut[i] = std::sin(2 * MathConstants<float>::pi * (float)mPhase);
+                cosOut[i] = std::cos(2 * MathConstants<float>::pi * (float)mPhase);
+
+                mPhase += mPhaseIncrement;
+                if (mPhase >= 1) {
+                    mPhase -= 1;
+                }
+            }
+            return;
+        }
+
+        case Mode::wavetable:
+        {
+            const float* table = getSineTable();
+
+            // 32 bit phase accumulator - the top bits index the table, the rest are the interpolation fraction
+            const int fractionBits = 32 - LFO_TABLE_BITS;
+            const uint32 fractionMask = (1u << fractionBits) - 1;
+            const float fractionScale = 1.0f / (float)(1u << fractionBits);
+
+            // Through 64 bits and masked - a phase a rounding step below 1 can scale to exactly 2^32, which doesn't fit
+            uint32 phase = (uint32)((uint64)(mPhase * 4294967296.0) & 0xffffffffu);
+            const uint32 increment = (uint32)((uint64)(mPhaseIncrement * 4294967296.0) & 0xffffffffu);
+
+            for (int i = 0; i < numSamples; i++) {
+                const int sinIndex = (int)(phase >> fractionBits);
+                const int cosIndex = (sinIndex + LFO_TABLE_SIZE / 4) & (LFO_TABLE_SIZE - 1);
+                const float frac = (float)(phase & fractionMask) * fractionScale;
+
+                sinOut[i] = table[sinIndex] + frac * (table[sinIndex + 1] - table[sinIndex]);
+                cosOut[i] = table[cosIndex] + frac * (table[cosIndex + 1] - table[cosIndex]);
+
+                phase += increment; // wraps around at one cycle for free
+            }
+
+            mPhase += mPhaseIncrement * numSamples;
+            mPhase -= std::floor(mPhase);
+            return;
+        }
+
+        case Mode::quadrature:
+        {
+            float c = mRotorCos;
+            float s = mRotorSin;
+
+            // Each step is one complex multiply: (c + is) * (stepCos + i stepSin)
+            for (int i = 0; i < numSamples; i++) {
+                sinOut[i] = s;
+                cosOut[i] = c;
+
+                const float nextCos = c * mStepCos - s * mStepSin;
+                s = s * mStepCos + c * mStepSin;
+                c = nextCos;
+            }
+
+            mRotorCos = c;
+            mRotorSin = s;
+
+            // Rounding also drifts the rotor's phase - restart it from the exact phase once per cycle
+            mPhase += mPhaseIncrement * numSamples;
+            if (mPhase >= 1) {
+                mPhase -= std::floor(mPhase);
+                resyncRotor(mPhase);
+            }
+            else {
+                renormaliseRotor();
+            }
+            return;
+        }
+    }
+}
+
+void LFO::renderControlRate(float* sinOut, float* cosOut, int numSamples)
+{
+    for (int i = 0; i < numSamples; i++) {
+
+        // Start a new straight line segment towards the next keyframe
+        if (mSegmentRemaining == 0) {
+            mSegmentSin = mKeySin;
+            mSegmentCos = mKeyCos;
+
+            nextKeyframe();
+
+            mSegmentSinStep = (mKeySin - mSegmentSin) / mControlRateInterval;
+            mSegmentCosStep = (mKeyCos - mSegmentCos) / mControlRateInterval;
+            mSegmentRemaining = mControlRateInterval;
+        }
+
+        sinOut[i] = mSegmentSin;
+        cosOut[i] = mSegmentCos;
+
+        mSegmentSin += mSegmentSinStep;
+        mSegmentCos += mSegmentCosStep;
+        mSegmentRemaining--;
+    }
+
+    mPhase += mPhaseIncrement * numSamples;
+    mPhase -= std::floor(mPhase);
+}
+
+void LFO::nextKeyframe()
+{
+    mKeyPhase += mPhaseIncrement * mControlRateInterval;
+
+    if (mMode == Mode::quadrature) {
+        if (mKeyPhase >= 1) {
+            mKeyPhase -= std::floor(mKeyPhase);
+            resyncRotor(mKeyPhase);
+        }
+        else {
+            const float nextCos = mRotorCos * mIntervalCos - mRotorSin * mIntervalSin;
+            mRotorSin = mRotorSin * mIntervalCos + mRotorCos * mIntervalSin;
+            mRotorCos = nextCos;
+            renormaliseRotor();
+        }
+
+        mKeySin = mRotorSin;
+        mKeyCos = mRotorCos;
+        return;
+    }
+
+    mKeyPhase -= std::floor(mKeyPhase);
+    evaluate(mKeyPhase, mKeySin, mKeyCos);
+}
+
+//==============================================================================
+void LFO::evaluate(double phase, float& sinOut, float& cosOut) const
+{
+    if (mMode == Mode::wavetable) {
+        const float* table = getSineTable();
+
+        // Linear interpolation between table points - cos is the same lookup a quarter cycle later
+        const double position = phase * LFO_TABLE_SIZE;
+        const int index = (int)position;
+        const float frac = (float)(position - index);
+
+        const int sinIndex = index & (LFO_TABLE_SIZE - 1);
+        const int cosIndex = (index + LFO_TABLE_SIZE / 4) & (LFO_TABLE_SIZE - 1);
+
+        sinOut = table[sinIndex] + frac * (table[sinIndex + 1] - table[sinIndex]);
+        cosOut = table[cosIndex] + frac * (table[cosIndex + 1] - table[cosIndex]);
+        return;
+    }
+
+    sinOut = (float)std::sin(MathConstants<double>::twoPi * phase);
+    cosOut = (float)std::cos(MathConstants<double>::twoPi * phase);
+}
+
+void LFO::resyncRotor(double phase)
+{
+    mRotorCos = (float)std::cos(MathConstants<double>::twoPi * phase);
+    mRotorSin = (float)std::sin(MathConstants<double>::twoPi * phase);
+}
+
+void LFO::renormaliseRotor()
+{
+    // Rounding makes the rotor spiral slowly in or out - one Newton step towards |z| = 1 corrects it
+    const float gain = 1.5f - 0.5f * (mRotorCos * mRotorCos + mRotorSin * mRotorSin);
+    mRotorCos *= gain;
+    mRotorSin *= gain;
+}
@@ -0,0 +1,92 @@
+/*
+  ==============================================================================
+
+    LFO.h
+    Sine LFO that sweeps the delay times, with a choice of cheap back ends.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "EngineModules.h"
+
+// Number of points in the shared sine wavetable (power of two)
+# define LFO_TABLE_BITS 12
+# define LFO_TABLE_SIZE (1 << LFO_TABLE_BITS)
+
+//==============================================================================
+/**
+    Produces sin and cos of the LFO phase for a block of samples.
+
+    Having both outputs means any phase offset can be applied afterwards as a fixed
+    rotation (sin(a + b) = sin(a) cos(b) + cos(a) sin(b)) instead of a second evaluation.
+*/
+class LFO
+{
+public:
+    enum class Mode
+    {
+        sine, // std::sin/std::cos every sample - reference for accuracy, slowest
+        quadrature, // recursive rotor, one complex multiply per sample
+        wavetable // interpolated lookup into a sine table shared by every instance
+    };
+
+    LFO();
+
+    //==============================================================================
+    void prepare(double sampleRate);
+    void reset(double phase = 0.0); // phase in cycles (0 to 1)
+
+    void setMode(Mode newMode);
+    Mode getMode() const { return mMode; }
+
+    // Evaluates the LFO every numSamples samples and interpolates in between (1 = every sample)
+    void setControlRateInterval(int numSamples);
+    int getControlRateInterval() const { return mControlRateInterval; }
+
+    void setFrequency(float frequencyHz);
+
+    //==============================================================================
+    // Writes the next numSamples LFO values, and advances the phase
+    void process(float* sinOut, float* cosOut, int numSamples);
+
+    double getPhase() const { return mPhase; } // phase of the next output sample, in cycles
+
+    // Shared read-only table of LFO_TABLE_SIZE + 1 sine points covering one cycle (last point == first)
+    static const float* getSineTable();
+
+private:
+    void renderAudioRate(float* sinOut, float* cosOut, int numSamples);
+    void renderControlRate(float* sinOut, float* cosOut, int numSamples);
+
+    void evaluate(double phase, float& sinOut, float& cosOut) const; // direct evaluation (sine/wavetable)
+    void nextKeyframe(); // moves the control rate keyframe one interval on
+    void resyncRotor(double phase); // restarts the rotor from an exact phase
+    void renormaliseRotor(); // pulls the rotor back onto the unit circle
+
+    void updateCoefficients();
+
+    double mSampleRate;
+    Mode mMode;
+    int mControlRateInterval;
+
+    float mFrequency;
+    double mPhase; // in cycles, always 0 to 1
+    double mPhaseIncrement;
+
+    /* Quadrature rotor - (cos, sin) of the current phase and the rotation per step */
+    float mRotorCos, mRotorSin;
+    float mStepCos, mStepSin; // one sample
+    float mIntervalCos, mIntervalSin; // one control rate interval
+
+    /* Control rate state */
+    double mKeyPhase; // phase of the current keyframe
+    float mKeySin, mKeyCos; // LFO value at the current keyframe
+    float mSegmentSin, mSegmentCos; // interpolated output
+    float mSegmentSinStep, mSegmentCosStep;
+    int mSegmentRemaining;
+
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LFO)
+};
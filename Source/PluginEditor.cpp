@@ -15,7 +15,7 @@ ChorusFlangerAudioProcessorEditor::ChorusFlangerAudioProcessorEditor (ChorusFlan
 {
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
-    setSize(510, 440);
+    setSize(510, 570);
 
     auto& params = processor.getParameters();
 
@@ -166,10 +166,200 @@ ChorusFlangerAudioProcessorEditor::ChorusFlangerAudioProcessorEditor (ChorusFlan
     };
 
     mType.setSelectedItemIndex(*typeParameter);
+
+
+    // ComboBox Voices --------------------------------------------------------------------------------------
+    AudioParameterInt* voicesParameter = (AudioParameterInt*)params.getUnchecked(6);
+
+    mVoices.setBounds(340, 370, 100, 30);
+    for (int voices = voicesParameter->getRange().getStart(); voices <= voicesParameter->getRange().getEnd(); voices++) {
+        mVoices.addItem(String(voices) + (voices == 1 ? " Voice" : " Voices"), voices); // item ID is the voice count
+    }
+    addAndMakeVisible(mVoices);
+
+    mVoices.onChange = [this, voicesParameter] {
+        voicesParameter->beginChangeGesture();
+        *voicesParameter = mVoices.getSelectedId();
+        voicesParameter->endChangeGesture();
+    };
+
+    mVoices.setSelectedId(*voicesParameter, juce::dontSendNotification);
+
+
+    // ComboBox Oversampling --------------------------------------------------------------------------------
+    AudioParameterInt* oversamplingParameter = (AudioParameterInt*)params.getUnchecked(7);
+
+    mOversampling.setBounds(340, 270, 100, 30);
+    for (int order = oversamplingParameter->getRange().getStart(); order <= oversamplingParameter->getRange().getEnd(); order++) {
+        mOversampling.addItem(String(1 << order) + "x", order + 1); // item ID is the order + 1 (IDs can't be 0)
+    }
+    addAndMakeVisible(mOversampling);
+
+    mOversampling.onChange = [this, oversamplingParameter] {
+        oversamplingParameter->beginChangeGesture();
+        *oversamplingParameter = mOversampling.getSelectedId() - 1;
+        oversamplingParameter->endChangeGesture();
+    };
+
+    mOversampling.setSelectedId(*oversamplingParameter + 1, juce::dontSendNotification);
+
+
+    // ComboBox Interpolation -------------------------------------------------------------------------------
+    AudioParameterInt* interpolationParameter = (AudioParameterInt*)params.getUnchecked(8);
+
+    mInterpolation.setBounds(340, 420, 100, 30);
+    mInterpolation.addItem("Linear", 1); // cheapest
+    mInterpolation.addItem("Hermite", 2);
+    mInterpolation.addItem("Lagrange", 3);
+    mInterpolation.addItem("Thiran", 4);
+    addAndMakeVisible(mInterpolation);
+
+    mInterpolation.onChange = [this, interpolationParameter] {
+        interpolationParameter->beginChangeGesture();
+        *interpolationParameter = mInterpolation.getSelectedItemIndex();
+        interpolationParameter->endChangeGesture();
+    };
+
+    mInterpolation.setSelectedItemIndex(*interpolationParameter, juce::dontSendNotification);
+
+
+    // ComboBox Delay Precision -----------------------------------------------------------------------------
+    AudioParameterInt* delayPrecisionParameter = (AudioParameterInt*)params.getUnchecked(9);
+
+    mDelayPrecision.setBounds(195, 425, 100, 30);
+    mDelayPrecision.addItem("32-bit", 1);
+    mDelayPrecision.addItem("64-bit", 2); // cleaner at high feedback
+    mDelayPrecision.addItem("16-bit", 3); // half the delay memory, for dense sessions
+    addAndMakeVisible(mDelayPrecision);
+
+    mDelayPrecision.onChange = [this, delayPrecisionParameter] {
+        delayPrecisionParameter->beginChangeGesture();
+        *delayPrecisionParameter = mDelayPrecision.getSelectedItemIndex();
+        delayPrecisionParameter->endChangeGesture();
+    };
+
+    mDelayPrecision.setSelectedItemIndex(*delayPrecisionParameter, juce::dontSendNotification);
+
+
+    // ComboBox Preset --------------------------------------------------------------------------------------
+    mPreset.setBounds(20, 10, 150, 25);
+
+    for (int index = 0; index < audioProcessor.getNumPrograms(); index++) {
+        mPreset.addItem(audioProcessor.getProgramName(index), index + 1);
+    }
+
+    addAndMakeVisible(mPreset);
+
+    mPreset.onChange = [this] {
+        audioProcessor.setCurrentProgram(mPreset.getSelectedItemIndex());
+        audioProcessor.updateHostDisplay(); // lets the host's program menu follow
+    };
+
+    mPreset.setSelectedItemIndex(audioProcessor.getCurrentProgram(), juce::dontSendNotification);
+
+
+    // Modulation Display -----------------------------------------------------------------------------------
+    mModulationDisplay.setBounds(20, 470, 470, 85);
+    addAndMakeVisible(mModulationDisplay);
+
+   #if CHORUSFLANGER_PROFILING
+    mProfileLabel.setBounds(330, 10, 160, 25);
+    mProfileLabel.setFont(juce::Font(11.0f));
+    mProfileLabel.setJustificationType(juce::Justification::centredRight);
+    addAndMakeVisible(mProfileLabel);
+   #endif
+
+    // Throw away anything left from an editor that was open before, then ask the audio thread for telemetry
+    TelemetryFrame staleFrame;
+    while (audioProcessor.getTelemetry().pop(staleFrame)) {}
+
+    audioProcessor.setTelemetryEnabled(true);
+    startTimerHz(EDITOR_REFRESH_RATE);
 }
 
 ChorusFlangerAudioProcessorEditor::~ChorusFlangerAudioProcessorEditor()
 {
+    stopTimer();
+    audioProcessor.setTelemetryEnabled(false);
+}
+
+void ChorusFlangerAudioProcessorEditor::timerCallback()
+{
+    // Drain everything the audio thread sent since the last tick - the display shows the newest frame, with the
+    // loudest peaks of all of them so no transient slips between ticks
+    TelemetryFrame frame, latest;
+    bool received = false;
+
+    while (audioProcessor.getTelemetry().pop(frame)) {
+        if (received) {
+            for (int channel = 0; channel < TELEMETRY_CHANNELS; channel++) {
+                frame.inputPeak[channel] = jmax(frame.inputPeak[channel], latest.inputPeak[channel]);
+                frame.outputPeak[channel] = jmax(frame.outputPeak[channel], latest.outputPeak[channel]);
+            }
+        }
+
+        latest = frame;
+        received = true;
+    }
+
+    if (received) {
+        mModulationDisplay.update(latest);
+    }
+    else {
+        mModulationDisplay.decay();
+    }
+
+    syncControls();
+
+   #if CHORUSFLANGER_PROFILING
+    showProfile();
+   #endif
+}
+
+#if CHORUSFLANGER_PROFILING
+void ChorusFlangerAudioProcessorEditor::showProfile()
+{
+    auto& profiler = audioProcessor.getProfiler();
+    ProfileStats stats = profiler.getStats(blockStage);
+
+    mProfileLabel.setText("CPU " + String(100.0f * profiler.getCpuLoad(), 1) + "%  p99 " + String(stats.p99, 1)
+                          + " us  max " + String(stats.max, 1) + " us", juce::dontSendNotification);
+}
+#endif
+
+// Slider and ComboBox helpers for syncControls - a control the user is holding is left alone
+static void syncSlider(Slider& slider, float value)
+{
+    if (! slider.isMouseButtonDown() && slider.getValue() != value) {
+        slider.setValue(value, juce::dontSendNotification);
+    }
+}
+
+static void syncComboBoxId(ComboBox& comboBox, int itemId)
+{
+    if (comboBox.getSelectedId() != itemId) {
+        comboBox.setSelectedId(itemId, juce::dontSendNotification);
+    }
+}
+
+void ChorusFlangerAudioProcessorEditor::syncControls()
+{
+    // Host automation and preset changes move the parameters behind the editor's back
+    auto& params = processor.getParameters();
+
+    syncSlider(mDryWetSlider, *(AudioParameterFloat*)params.getUnchecked(0));
+    syncSlider(mDepthSlider, *(AudioParameterFloat*)params.getUnchecked(1));
+    syncSlider(mRateSlider, *(AudioParameterFloat*)params.getUnchecked(2));
+    syncSlider(mPhaseOffsetSlider, *(AudioParameterFloat*)params.getUnchecked(3));
+    syncSlider(mFeedbackSlider, *(AudioParameterFloat*)params.getUnchecked(4));
+
+    // Item IDs as set up in the constructor
+    syncComboBoxId(mType, *(AudioParameterInt*)params.getUnchecked(5) + 1);
+    syncComboBoxId(mVoices, *(AudioParameterInt*)params.getUnchecked(6));
+    syncComboBoxId(mOversampling, *(AudioParameterInt*)params.getUnchecked(7) + 1);
+    syncComboBoxId(mInterpolation, *(AudioParameterInt*)params.getUnchecked(8) + 1);
+    syncComboBoxId(mDelayPrecision, *(AudioParameterInt*)params.getUnchecked(9) + 1);
+    syncComboBoxId(mPreset, audioProcessor.getCurrentProgram() + 1);
 }
 
 //==============================================================================
@@ -195,3 +385,119 @@ void ChorusFlangerAudioProcessorEditor::resized()
     mDryWetSlider.setBounds(border+200, border, dialWidth, dialHeight);
     */
 }
+
+//==============================================================================
+ModulationDisplay::ModulationDisplay()
+{
+    mFrame = {};
+
+    for (int channel = 0; channel < TELEMETRY_CHANNELS; channel++) {
+        mInputLevel[channel] = 0;
+        mOutputLevel[channel] = 0;
+    }
+}
+
+void ModulationDisplay::update(const TelemetryFrame& frame)
+{
+    mFrame = frame;
+
+    // Meters jump up to a new peak, and fall back slowly from it
+    decay();
+
+    for (int channel = 0; channel < TELEMETRY_CHANNELS; channel++) {
+        mInputLevel[channel] = jmax(mInputLevel[channel], frame.inputPeak[channel]);
+        mOutputLevel[channel] = jmax(mOutputLevel[channel], frame.outputPeak[channel]);
+    }
+
+    repaint();
+}
+
+void ModulationDisplay::decay()
+{
+    // About 60 dB a second at the editor's refresh rate
+    const float fall = 0.8f;
+
+    for (int channel = 0; channel < TELEMETRY_CHANNELS; channel++) {
+        mInputLevel[channel] *= fall;
+        mOutputLevel[channel] *= fall;
+    }
+
+    repaint();
+}
+
+// Level meter position (0 to 1) over the bottom 60 dB
+static float getMeterProportion(float level)
+{
+    return jmap(jlimit(-60.0f, 0.0f, Decibels::gainToDecibels(level, -60.0f)), -60.0f, 0.0f, 0.0f, 1.0f);
+}
+
+void ModulationDisplay::paint(Graphics& g)
+{
+    auto bounds = getLocalBounds().reduced(1);
+
+    g.setColour(juce::Colours::lightskyblue);
+    g.drawRoundedRectangle(bounds.toFloat(), 4.0f, 1.0f);
+
+    bounds = bounds.reduced(8);
+
+    // LFO - one cycle of its sine, with the current phase marked
+    auto lfoArea = bounds.removeFromLeft(160).toFloat();
+    const float centreY = lfoArea.getCentreY();
+    const float amplitude = 0.5f * lfoArea.getHeight() - 4.0f;
+
+    Path cycle;
+    cycle.startNewSubPath(lfoArea.getX(), centreY);
+
+    for (int point = 1; point <= 64; point++) {
+        float phase = point / 64.0f;
+        cycle.lineTo(lfoArea.getX() + phase * lfoArea.getWidth(), centreY - amplitude * std::sin(2 * MathConstants<float>::pi * phase));
+    }
+
+    g.setColour(juce::Colours::darkblue);
+    g.strokePath(cycle, PathStrokeType(1.5f));
+
+    const float dotX = lfoArea.getX() + mFrame.lfoPhase * lfoArea.getWidth();
+    const float dotY = centreY - amplitude * std::sin(2 * MathConstants<float>::pi * mFrame.lfoPhase);
+
+    g.setColour(juce::Colours::whitesmoke);
+    g.fillEllipse(dotX - 4.0f, dotY - 4.0f, 8.0f, 8.0f);
+
+    bounds.removeFromLeft(16);
+
+    // Delay times - left and right against the longest delay either type reaches
+    auto delayArea = bounds.removeFromLeft(170);
+    const float maxDelayMs = MAX_DELAY_TIME * 1000.0f;
+    const char* channelNames[TELEMETRY_CHANNELS] = { "L", "R" };
+
+    g.setFont(juce::Font(13.0f));
+
+    for (int channel = 0; channel < TELEMETRY_CHANNELS; channel++) {
+        auto row = delayArea.removeFromTop(delayArea.getHeight() / (TELEMETRY_CHANNELS - channel)).reduced(0, 4);
+        auto label = row.removeFromLeft(16);
+        auto text = row.removeFromRight(60);
+
+        g.setColour(juce::Colours::lightskyblue);
+        g.drawText(channelNames[channel], label, Justification::centredLeft);
+        g.drawText(String(mFrame.delayTimeMs[channel], 2) + " ms", text, Justification::centredRight);
+        g.drawRect(row);
+
+        g.setColour(juce::Colours::darkblue);
+        g.fillRect(row.reduced(2).removeFromLeft(roundToInt((row.getWidth() - 4) * jlimit(0.0f, 1.0f, mFrame.delayTimeMs[channel] / maxDelayMs))));
+    }
+
+    bounds.removeFromLeft(16);
+
+    // Meters - input left/right, then output left/right
+    const float levels[] = { mInputLevel[0], mInputLevel[1], mOutputLevel[0], mOutputLevel[1] };
+    const int meterWidth = bounds.getWidth() / 4;
+
+    for (float level : levels) {
+        auto meter = bounds.removeFromLeft(meterWidth).reduced(3, 0);
+
+        g.setColour(juce::Colours::lightskyblue);
+        g.drawRect(meter);
+
+        g.setColour(level >= 1.0f ? juce::Colours::red : juce::Colours::whitesmoke);
+        g.fillRect(meter.reduced(2).removeFromBottom(roundToInt((meter.getHeight() - 4) * getMeterProportion(level))));
+    }
+}
@@ -11,6 +11,9 @@
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
 
+// Times per second the editor drains the telemetry and refreshes - plenty for meters and a moving LFO
+# define EDITOR_REFRESH_RATE 30
+
 //==============================================================================
 
 class SliderLookAndFeel : public LookAndFeel_V4
@@ -35,7 +38,30 @@ public:
 };
 
 
-class ChorusFlangerAudioProcessorEditor  : public juce::AudioProcessorEditor
+// Live view of the engine from the telemetry - the LFO phase on one cycle of its sine, the left and right delay
+// times against the full range, and input/output level meters
+class ModulationDisplay : public Component
+{
+public:
+    ModulationDisplay();
+
+    // Takes the newest frame, with its peaks already combined with any frames drained before it
+    void update(const TelemetryFrame& frame);
+
+    // Lets the meters fall back when no frames arrive (e.g. playback stopped)
+    void decay();
+
+    void paint(Graphics& g) override;
+
+private:
+    TelemetryFrame mFrame;
+    float mInputLevel[TELEMETRY_CHANNELS]; // meter levels, falling back smoothly between peaks
+    float mOutputLevel[TELEMETRY_CHANNELS];
+};
+
+
+class ChorusFlangerAudioProcessorEditor  : public juce::AudioProcessorEditor,
+                                           private juce::Timer
 {
 public:
     ChorusFlangerAudioProcessorEditor (ChorusFlangerAudioProcessor&);
@@ -46,6 +72,13 @@ public:
     void resized() override;
 
 private:
+    void timerCallback() override; // drains the telemetry and follows host automation
+    void syncControls(); // moves the controls to the current parameter values
+
+   #if CHORUSFLANGER_PROFILING
+    void showProfile(); // CPU load and block latency, in profiling builds
+   #endif
+
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
     ChorusFlangerAudioProcessor& audioProcessor;
@@ -66,6 +99,17 @@ private:
     Label mFeedbackLabel;
 
     ComboBox mType;
+    ComboBox mVoices; // chorus voices per channel
+    ComboBox mOversampling; // 1x, 2x or 4x delay core
+    ComboBox mInterpolation; // fractional delay quality
+    ComboBox mDelayPrecision; // delay storage precision, independent of the host's
+    ComboBox mPreset; // factory bank, through the processor's program API
+
+    ModulationDisplay mModulationDisplay;
+
+   #if CHORUSFLANGER_PROFILING
+    Label mProfileLabel;
+   #endif
 
     SliderLookAndFeel sliderLookAndFeel;
     LabelLookAndFeel labelLookAndFeel;
@@ -7,7 +7,9 @@
 */
 
 #include "PluginProcessor.h"
-#include "PluginEditor.h"
+#if ! CHORUSFLANGER_HEADLESS
+ #include "PluginEditor.h"
+#endif
 
 //==============================================================================
 ChorusFlangerAudioProcessor::ChorusFlangerAudioProcessor()
@@ -40,8 +42,8 @@ ChorusFlangerAudioProcessor::ChorusFlangerAudioProcessor()
     addParameter(mRateParameter = new AudioParameterFloat(
         "rate",
         "Rate",
-        0.1f,
-        20.f,
+        MIN_RATE,
+        MAX_RATE,
         10.f));
 
     addParameter(mPhaseOffsetParameter = new AudioParameterFloat(
@@ -55,7 +57,7 @@ ChorusFlangerAudioProcessor::ChorusFlangerAudioProcessor()
         "feedback",
         "Feedback",
         0.0f,
-        0.98f,
+        MAX_FEEDBACK,
         0.5f));
 
     addParameter(mTypeParameter = new AudioParameterInt(
@@ -65,22 +67,60 @@ ChorusFlangerAudioProcessor::ChorusFlangerAudioProcessor()
         1,
         0));
 
+    addParameter(mVoicesParameter = new AudioParameterInt(
+        "voices",
+        "Voices",
+        1,
+        MAX_VOICES,
+        1));
+
+    addParameter(mOversamplingParameter = new AudioParameterInt(
+        "oversampling",
+        "Oversampling",
+        0,
+        MAX_OVERSAMPLING_ORDER,
+        0));
+
+    addParameter(mInterpolationParameter = new AudioParameterInt(
+        "interpolation",
+        "Interpolation",
+        0,
+        NUM_INTERPOLATORS - 1,
+        0));
+
+    addParameter(mDelayPrecisionParameter = new AudioParameterInt(
+        "delayprecision",
+        "Delay Precision",
+        0,
+        NUM_DELAY_PRECISIONS - 1,
+        0));
 
     // Initialize data to default values
-    mCircularBufferLeft.reset(nullptr); // reset smart pointers to null
-    mCircularBufferRight.reset(nullptr); // reset smart pointers to null
-    mCircularbufferWriteHead = 0;
-    mCircularBufferLength = 0;
+    mEngine.setParameters(getParameterValues());
+
+    mCurrentProgram = 0;
+    mPendingProgram = -1;
+    mSwitchingProgram = -1;
+    mPublishingProgram = -1;
+    mLatencySamples = 0;
 
-    mFeedbackLeft = 0;
-    mFeedbackRight = 0;
+    startTimerHz(PUBLISH_RATE);
 
-    mLFOPhase = 0;
+    mTelemetryEnabled = false;
+    mTelemetryInterval = 1;
+    mTelemetrySamples = 0;
 
+    for (int channel = 0; channel < TELEMETRY_CHANNELS; channel++) {
+        mTelemetryInputPeak[channel] = 0;
+        mTelemetryOutputPeak[channel] = 0;
+    }
+
+    mLFOFollowsPlayHead = false;
 }
 
 ChorusFlangerAudioProcessor::~ChorusFlangerAudioProcessor()
 {
+    stopTimer();
 }
 
 //==============================================================================
@@ -118,27 +158,37 @@ bool ChorusFlangerAudioProcessor::isMidiEffect() const
 
 double ChorusFlangerAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    return mEngine.getTailLengthSeconds(getParameterValues());
 }
 
 int ChorusFlangerAudioProcessor::getNumPrograms()
 {
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
+    return NUM_FACTORY_PRESETS;
 }
 
 int ChorusFlangerAudioProcessor::getCurrentProgram()
 {
-    return 0;
+    return mCurrentProgram;
 }
 
 void ChorusFlangerAudioProcessor::setCurrentProgram (int index)
 {
+    // Any thread, including the audio thread - only posts the switch, processBlock carries it out
+    if (index < 0 || index >= NUM_FACTORY_PRESETS) {
+        return;
+    }
+
+    mCurrentProgram = index;
+    mPendingProgram = index;
 }
 
 const juce::String ChorusFlangerAudioProcessor::getProgramName (int index)
 {
-    return {};
+    if (index < 0 || index >= NUM_FACTORY_PRESETS) {
+        return {};
+    }
+
+    return getFactoryPreset(index).name;
 }
 
 void ChorusFlangerAudioProcessor::changeProgramName (int index, const juce::String& newName)
@@ -148,38 +198,60 @@ void ChorusFlangerAudioProcessor::changeProgramName (int index, const juce::Stri
 //==============================================================================
 void ChorusFlangerAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-    // Initialize data for the current sample rate, and reset things such as phase and writeheads
-
-    // Initialize Phase
-    mLFOPhase = 0;
+    // Nothing is playing yet, so a waiting or half-done preset switch can happen straight away
+    int pendingProgram = mPendingProgram.exchange(-1);
 
-    // Calculate circular buffer length
-    mCircularBufferLength = sampleRate * MAX_DELAY_TIME;
-
-    // Initialize smart pointers to new buffer of circular buffer length by using "reset"
-    if (mCircularBufferLeft == nullptr) {
-        mCircularBufferLeft.reset(new float[mCircularBufferLength]);
+    if (pendingProgram < 0) {
+        pendingProgram = mSwitchingProgram;
     }
 
-    if (mCircularBufferRight == nullptr) {
-        mCircularBufferRight.reset(new float[mCircularBufferLength]);
+    if (pendingProgram >= 0) {
+        applyPreset(pendingProgram);
     }
 
-    // Write 0s to buffers - clears out any garbage. Same function as zeromem, but doesn't crash Reaper
-    for (int i = 0; i < mCircularBufferLength; i++) {
-        mCircularBufferLeft[i] = 0;
-        mCircularBufferRight[i] = 0;
-    }
+    mSwitchingProgram = -1;
+    publishPreset(); // prepareToPlay is called on the message thread, or with processing stopped
+
+    // One delay line channel per bus channel. The host picks its precision before preparing - only that one
+    // gets filters and a dry line.
+    mEngine.setParameters(getParameterValues());
+    mEngine.prepare(sampleRate, samplesPerBlock, getTotalNumInputChannels(), isUsingDoublePrecision());
 
-    // Initialize writehead to 0
-    mCircularbufferWriteHead = 0;
+    mLatencySamples = mEngine.getLatencySamples();
+    setLatencySamples(mLatencySamples);
 
+    mTelemetryInterval = jmax(1, (int)(sampleRate / TELEMETRY_RATE));
+    mTelemetrySamples = 0;
+}
+
+void ChorusFlangerAudioProcessor::setLFOMode(LFO::Mode mode, int controlRateInterval)
+{
+    mEngine.setLFOMode(mode, controlRateInterval);
+}
+
+void ChorusFlangerAudioProcessor::prime(const AudioBuffer<float>& history, int64 position)
+{
+    primeFrom(history, position);
+}
+
+void ChorusFlangerAudioProcessor::prime(const AudioBuffer<double>& history, int64 position)
+{
+    primeFrom(history, position);
+}
+
+template <typename SampleType>
+void ChorusFlangerAudioProcessor::primeFrom(const AudioBuffer<SampleType>& history, int64 position)
+{
+    mEngine.setParameters(getParameterValues());
+    mEngine.prime(history.getArrayOfReadPointers(), jmin(getTotalNumInputChannels(), history.getNumChannels()),
+                  history.getNumSamples(), position);
 }
 
 void ChorusFlangerAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
+    mEngine.release();
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -190,11 +262,10 @@ bool ChorusFlangerAudioProcessor::isBusesLayoutSupported (const BusesLayout& lay
     return true;
   #else
     // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // Any layout works (mono, stereo, surround, ambisonics) up to MAX_CHANNELS -
+    // each channel gets its own share of the phase offset.
+    if (layouts.getMainOutputChannelSet().isDisabled()
+     || layouts.getMainOutputChannelSet().size() > MAX_CHANNELS)
         return false;
 
     // This checks if the input layout matches the output layout
@@ -210,17 +281,29 @@ bool ChorusFlangerAudioProcessor::isBusesLayoutSupported (const BusesLayout& lay
 
 void ChorusFlangerAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
-    juce::ScopedNoDenormals noDenormals;
-    auto totalNumInputChannels = getTotalNumInputChannels();
-    auto totalNumOutputChannels = getTotalNumOutputChannels();
+    process(buffer, false);
+}
+
+void ChorusFlangerAudioProcessor::processBlock (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    process(buffer, false);
+}
+
+void ChorusFlangerAudioProcessor::processBlockBypassed (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    process(buffer, true);
+}
 
-    DBG("DRY WET: " << *mDryWetParameter);
-    DBG("DEPTH: " << *mDepthParameter);
-    DBG("RATE: " << *mRateParameter);
-    DBG("PHASE OFFSET: " << *mPhaseOffsetParameter);
-    DBG("FEEDBACK: " << *mFeedbackParameter);
-    DBG("TYPE: " << (int)*mTypeParameter);
+void ChorusFlangerAudioProcessor::processBlockBypassed (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    process(buffer, true);
+}
 
+template <typename SampleType>
+void ChorusFlangerAudioProcessor::process(juce::AudioBuffer<SampleType>& buffer, bool bypassed)
+{
+    auto totalNumInputChannels = getTotalNumInputChannels();
+    auto totalNumOutputChannels = getTotalNumOutputChannels();
 
     // In case we have more outputs than inputs, this code clears any output
     // channels that didn't contain input data, (because these aren't
@@ -231,164 +314,273 @@ void ChorusFlangerAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear(i, 0, buffer.getNumSamples());
 
-    // Obtain the left and right audio data pointers
-    float* leftChannel = buffer.getWritePointer(0);
-    float* rightChannel = buffer.getWritePointer(1);
+    const int numChannels = jmin(totalNumInputChannels, buffer.getNumChannels());
+
+    // The engine takes one consistent parameter snapshot for the whole block, after any preset switch due this block
+    updatePresetSwitch();
+    mEngine.setParameters(getParameterValues());
+    updatePlayHeadPosition();
 
-    // Iterate through all of the samples in the buffer
-    for (int i = 0; i < buffer.getNumSamples(); i++) {
+    // The input peaks are only worth scanning for an open editor
+    if (mTelemetryEnabled.load(std::memory_order_relaxed)) {
+        for (int channel = 0; channel < jmin(numChannels, TELEMETRY_CHANNELS); channel++) {
+            float channelPeak = (float)buffer.getMagnitude(channel, 0, buffer.getNumSamples());
+            mTelemetryInputPeak[channel] = jmax(mTelemetryInputPeak[channel], channelPeak);
+        }
+    }
 
-        // Write buffer sample per each iteration into circular buffer
-        mCircularBufferLeft[mCircularbufferWriteHead] = leftChannel[i] + mFeedbackLeft;
-        mCircularBufferRight[mCircularbufferWriteHead] = rightChannel[i] + mFeedbackRight;
+    mEngine.process(buffer.getArrayOfWritePointers(), numChannels, buffer.getNumSamples(), bypassed);
 
-        // ------------------------------------------------------------
+    // A new oversampling order changes the latency. Telling the host can lock and allocate, so the timer does
+    // it on the message thread - straight away if this is the message thread.
+    mLatencySamples.store(mEngine.getLatencySamples(), std::memory_order_relaxed);
 
-        // Generate LFOs
-        //  Left
-        float lfoOutLeft = sin(2 * MathConstants<float>::pi * mLFOPhase);
+    if (MessageManager::existsAndIsCurrentThread()) {
+        publishLatency();
+    }
 
-        //  Right
-        float lfoPhaseRight = mLFOPhase + *mPhaseOffsetParameter;
-        if (lfoPhaseRight > 1) {
-            lfoPhaseRight -= 1;
-        }
-        float lfoOutRight = sin(2 * MathConstants<float>::pi * lfoPhaseRight);
+    sendTelemetry(buffer, numChannels);
+}
 
-        // Move LFO phase forward
-        mLFOPhase += *mRateParameter / getSampleRate();
+template <typename SampleType>
+void ChorusFlangerAudioProcessor::sendTelemetry(const juce::AudioBuffer<SampleType>& buffer, int numChannels)
+{
+    // No editor - drop what was gathered, so the first frame after it opens only covers its own interval
+    if (! mTelemetryEnabled.load(std::memory_order_relaxed)) {
+        mTelemetrySamples = 0;
 
-        if (mLFOPhase > 1) {
-            mLFOPhase -= 1;
+        for (int channel = 0; channel < TELEMETRY_CHANNELS; channel++) {
+            mTelemetryInputPeak[channel] = 0;
+            mTelemetryOutputPeak[channel] = 0;
         }
 
-        // Multiply by the depth parameter (control LFO depth)
-        lfoOutLeft *= *mDepthParameter;
-        lfoOutRight *= *mDepthParameter;
+        return;
+    }
 
-        // ------------------------------------------------------------
+    for (int channel = 0; channel < jmin(numChannels, TELEMETRY_CHANNELS); channel++) {
+        float channelPeak = (float)buffer.getMagnitude(channel, 0, buffer.getNumSamples());
+        mTelemetryOutputPeak[channel] = jmax(mTelemetryOutputPeak[channel], channelPeak);
+    }
 
-        // Chorus/Flanger
-        float lfoOutMappedLeft = 0;
-        float lfoOutMappedRight = 0;
-        // Chorus (5ms to 30 ms)
-        if (*mTypeParameter == 0) {
-            // Map LFO outputs to  desired delay times (e.g. instead of -1 to 1 becomes 5ms to 30 ms)
-            lfoOutMappedLeft = jmap(lfoOutLeft, -1.f, 1.f, 0.005f, 0.030f);
-            lfoOutMappedRight = jmap(lfoOutRight, -1.f, 1.f, 0.005f, 0.030f);
-        }
-        // Flanger (1ms to 5 ms)
-        else {
-            // Map LFO outputs to  desired delay times (e.g. instead of -1 to 1 becomes 1ms to 5 ms)
-            lfoOutMappedLeft = jmap(lfoOutLeft, -1.f, 1.f, 0.001f, 0.005f);
-            lfoOutMappedRight = jmap(lfoOutRight, -1.f, 1.f, 0.001f, 0.005f);
-        }
+    mTelemetrySamples += buffer.getNumSamples();
 
-        // ------------------------------------------------------------
+    if (mTelemetrySamples < mTelemetryInterval) {
+        return;
+    }
 
-        // Delay time smoothing (calculate delay lengths in samples)
-        int delayTimeSamplesLeft = getSampleRate() * lfoOutMappedLeft;
-        float delayTimeSamplesRight = getSampleRate() * lfoOutMappedRight;
+    // The delay times of the last tile the engine ran - the first voice of each channel, in ms
+    TelemetryFrame frame;
+    frame.lfoPhase = (float)mEngine.getLFOPhase();
 
-        // ------------------------------------------------------------
+    for (int channel = 0; channel < TELEMETRY_CHANNELS; channel++) {
+        frame.delayTimeMs[channel] = mEngine.getDelayTimeMs(channel);
+        frame.inputPeak[channel] = mTelemetryInputPeak[channel];
+        frame.outputPeak[channel] = mTelemetryOutputPeak[channel];
 
-        // calculate the left read head position
-        float delayReadHeadLeft = mCircularbufferWriteHead - delayTimeSamplesLeft;
-        if (delayReadHeadLeft < 0) { // Need to make sure that samples are not less than 0
-            delayReadHeadLeft += mCircularBufferLength;
-        }
+        mTelemetryInputPeak[channel] = 0;
+        mTelemetryOutputPeak[channel] = 0;
+    }
 
-        // calculate the right read head position
-        float delayReadHeadRight = mCircularbufferWriteHead - delayTimeSamplesRight;
-        if (delayReadHeadRight < 0) { // Need to make sure that samples are not less than 0
-            delayReadHeadRight += mCircularBufferLength;
-        }
+    mTelemetry.push(frame); // a full FIFO just drops the frame
+    mTelemetrySamples %= mTelemetryInterval; // carry the remainder, so the frame rate holds whatever the block size
+}
 
-        // ------------------------------------------------------------
-
-        // Interpolation
-        
-        // Separating out the readHead into the integer value and the remaining decimal value for interpolation
-        // Left - Calculate linear interpolation points
-        int readHeadLeft_x = (int)delayReadHeadLeft; // truncate to integer value
-        int readHeadLeft_x1 = readHeadLeft_x + 1;
-        float readHeadFloatLeft = delayReadHeadLeft - readHeadLeft_x; // assign remainder (demcimals)
-        if (readHeadLeft_x1 >= mCircularBufferLength) {
-            readHeadLeft_x1 -= mCircularBufferLength;
+void ChorusFlangerAudioProcessor::updatePlayHeadPosition()
+{
+    if (! mLFOFollowsPlayHead.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    // Stopped, the host position stands still while the blocks keep coming - count on from it ourselves
+    if (auto* playHead = getPlayHead()) {
+        if (auto position = playHead->getPosition()) {
+            if (position->getIsPlaying()) {
+                if (auto timeInSamples = position->getTimeInSamples()) {
+                    mEngine.seek(*timeInSamples);
+                }
+            }
         }
+    }
+}
+
+void ChorusFlangerAudioProcessor::updatePresetSwitch()
+{
+    if (mSwitchingProgram < 0) {
+        // Start ducking for a new switch - from wherever the duck is, if the last one is still fading in
+        mSwitchingProgram = mPendingProgram.exchange(-1);
 
-        // Right - Calculate linear interpolation points
-        int readHeadRight_x = (int)delayReadHeadRight; // truncate to integer value
-        int readHeadRight_x1 = readHeadRight_x + 1;
-        float readHeadFloatRight = delayReadHeadRight - readHeadRight_x; // assign remainder (demcimals)
-        if (readHeadRight_x1 >= mCircularBufferLength) {
-            readHeadRight_x1 -= mCircularBufferLength;
+        if (mSwitchingProgram >= 0) {
+            mEngine.duckOut();
         }
+    }
 
-        // Generate left and right output samples (interpolate)
-        float delay_sample_left = lin_interp(mCircularBufferLeft[readHeadLeft_x], mCircularBufferLeft[readHeadLeft_x1], readHeadFloatLeft);
-        float delay_sample_right = lin_interp(mCircularBufferRight[readHeadRight_x], mCircularBufferRight[readHeadRight_x1], readHeadFloatRight);
+    if (mSwitchingProgram < 0 || ! mEngine.isDuckedOut()) {
+        return;
+    }
 
-        // Add feedback by multiplying by feedback parameter value
-        mFeedbackLeft = delay_sample_left * *mFeedbackParameter;
-        mFeedbackRight = delay_sample_right * *mFeedbackParameter;
+    applyPreset(mSwitchingProgram);
+    mSwitchingProgram = -1;
 
-        // ------------------------------------------------------------
+    mEngine.duckIn();
+}
 
-        // Increment circular buffer write head
-        mCircularbufferWriteHead++;
+void ChorusFlangerAudioProcessor::applyPreset(int program)
+{
+    // Setting a parameter notifies the host, which mustn't happen on the audio thread - until the timer has
+    // done it, getParameterValues hands the engine the preset's values instead. A host (or a command-line tool)
+    // that processes on the message thread gets them straight away.
+    mPublishingProgram = program;
 
-        if (mCircularbufferWriteHead >= mCircularBufferLength) {
-            mCircularbufferWriteHead = 0;
-        }
+    if (MessageManager::existsAndIsCurrentThread()) {
+        publishPreset();
+    }
+
+    // The wet signal is out, so there is nothing to glide for
+    mEngine.jumpToParameters(getParameterValues());
+}
+
+void ChorusFlangerAudioProcessor::timerCallback()
+{
+    publishPreset();
+    publishLatency();
+}
+
+void ChorusFlangerAudioProcessor::publishLatency()
+{
+    // The host is only told when it changed
+    const int latencySamples = mLatencySamples.load(std::memory_order_relaxed);
+
+    if (latencySamples != getLatencySamples()) {
+        setLatencySamples(latencySamples);
+    }
+}
 
-        // ------------------------------------------------------------
+void ChorusFlangerAudioProcessor::publishPreset()
+{
+    int program = mPublishingProgram.load();
 
-        // adjust to dry/wet amount
-        float dryAmount = 1 - *mDryWetParameter;
-        float wetAmount = *mDryWetParameter;
+    if (program < 0) {
+        return;
+    }
 
-        buffer.setSample(0, i, buffer.getSample(0, i) * dryAmount + delay_sample_left * wetAmount);
-        buffer.setSample(1, i, buffer.getSample(1, i) * dryAmount + delay_sample_right * wetAmount);
+    const Preset& preset = getFactoryPreset(program);
+
+    *mDryWetParameter = preset.dryWet;
+    *mDepthParameter = preset.depth;
+    *mRateParameter = preset.rate;
+    *mPhaseOffsetParameter = preset.phaseOffset;
+    *mFeedbackParameter = preset.feedback;
+    *mTypeParameter = preset.type;
+    *mVoicesParameter = preset.voices;
+
+    // Only if no other preset was applied meanwhile - the next tick publishes that one
+    mPublishingProgram.compare_exchange_strong(program, -1);
+}
 
+ChorusFlangerParameters ChorusFlangerAudioProcessor::getParameterValues() const
+{
+    ChorusFlangerParameters parameters;
+
+    parameters.dryWet = *mDryWetParameter;
+    parameters.depth = *mDepthParameter;
+    parameters.rate = *mRateParameter;
+    parameters.phaseOffset = *mPhaseOffsetParameter;
+    parameters.feedback = *mFeedbackParameter;
+    parameters.type = *mTypeParameter;
+    parameters.voices = *mVoicesParameter;
+    parameters.oversampling = *mOversamplingParameter;
+    parameters.interpolation = *mInterpolationParameter;
+    parameters.delayPrecision = *mDelayPrecisionParameter;
+
+    // A preset the parameters haven't taken yet wins over them, so the engine doesn't glide back in between
+    const int publishingProgram = mPublishingProgram.load();
+
+    if (publishingProgram >= 0) {
+        const Preset& preset = getFactoryPreset(publishingProgram);
+
+        parameters.dryWet = preset.dryWet;
+        parameters.depth = preset.depth;
+        parameters.rate = preset.rate;
+        parameters.phaseOffset = preset.phaseOffset;
+        parameters.feedback = preset.feedback;
+        parameters.type = preset.type;
+        parameters.voices = preset.voices;
     }
+
+    return parameters;
 }
 
 //==============================================================================
 bool ChorusFlangerAudioProcessor::hasEditor() const
 {
-    return true; // (change this to false if you choose to not supply an editor)
+    return ! CHORUSFLANGER_HEADLESS; // (change this to false if you choose to not supply an editor)
 }
 
 juce::AudioProcessorEditor* ChorusFlangerAudioProcessor::createEditor()
 {
+   #if CHORUSFLANGER_HEADLESS
+    return nullptr;
+   #else
     return new ChorusFlangerAudioProcessorEditor (*this);
+   #endif
 }
 
 //==============================================================================
 void ChorusFlangerAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
+    // Compact binary state - the tag and version, the current program, then every parameter's value in parameter
+    // order. Parameters are only ever appended, so older states simply end early.
+    MemoryOutputStream stream(destData, false);
+    auto& parameters = getParameters();
+
+    stream.writeInt(STATE_MAGIC);
+    stream.writeInt(STATE_VERSION);
+    stream.writeInt(mCurrentProgram);
+    stream.writeInt(parameters.size());
+
+    for (auto* parameter : parameters) {
+        auto* rangedParameter = (RangedAudioParameter*)parameter;
+        stream.writeFloat(rangedParameter->convertFrom0to1(rangedParameter->getValue())); // plain values, so range changes don't shift them
+    }
+}
+
+void ChorusFlangerAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
+{
+    MemoryInputStream stream(data, (size_t)sizeInBytes, false);
 
-    std::unique_ptr<XmlElement> xml(new XmlElement("FlangerChorus"));
+    if (sizeInBytes >= 4 * (int)sizeof(int) && stream.readInt() == STATE_MAGIC) {
+        stream.readInt(); // version - every version so far only appends, so all of them read the same way
+        const int program = stream.readInt();
+        const int numValues = stream.readInt();
 
-    xml->setAttribute("DryWet", *mDryWetParameter);
-    xml->setAttribute("Depth", *mDepthParameter);
-    xml->setAttribute("Rate", *mRateParameter);
-    xml->setAttribute("PhaseOffset", *mPhaseOffsetParameter);
-    xml->setAttribute("Feedback", *mFeedbackParameter);
-    xml->setAttribute("Type", *mTypeParameter);
+        auto& parameters = getParameters();
 
-    copyXmlToBinary(*xml, destData);
+        for (int index = 0; index < parameters.size(); index++) {
+            auto* parameter = (RangedAudioParameter*)parameters.getUnchecked(index);
 
-}
+            // Parameters newer than the state get their defaults, values from newer versions are left unread.
+            // So do values that aren't numbers - a damaged state can hold NaN or Inf, which the ranges don't clamp.
+            float value = std::numeric_limits<float>::quiet_NaN();
 
-void ChorusFlangerAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
-{
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
+            if (index < numValues && stream.getNumBytesRemaining() >= (int64)sizeof(float)) {
+                value = stream.readFloat();
+            }
+
+            if (std::isfinite(value)) {
+                parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+            }
+            else {
+                parameter->setValueNotifyingHost(parameter->getDefaultValue());
+            }
+        }
+
+        mCurrentProgram = jlimit(0, NUM_FACTORY_PRESETS - 1, program);
+        mPendingProgram = -1; // the state already holds the values
+        mPublishingProgram = -1; // and replaces any preset still to be published
+        return;
+    }
+
+    // States saved before the binary format - the "FlangerChorus" XML
     std::unique_ptr<XmlElement> xml(getXmlFromBinary(data, sizeInBytes));
 
     if (xml.get() != nullptr && xml->hasTagName("FlangerChorus")) {
@@ -398,6 +590,12 @@ void ChorusFlangerAudioProcessor::setStateInformation (const void* data, int siz
         *mPhaseOffsetParameter = xml->getDoubleAttribute("PhaseOffset");
         *mFeedbackParameter = xml->getDoubleAttribute("Feedback");
         *mTypeParameter = xml->getIntAttribute("Type");
+        *mVoicesParameter = xml->getIntAttribute("Voices", 1); // missing from states saved before voices existed
+        *mOversamplingParameter = xml->getIntAttribute("Oversampling", 0);
+        *mInterpolationParameter = xml->getIntAttribute("Interpolation", 0);
+        *mDelayPrecisionParameter = xml->getIntAttribute("DelayPrecision", 0);
+
+        mPublishingProgram = -1; // the state replaces any preset still to be published
     }
 }
 
@@ -407,8 +605,3 @@ juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 {
     return new ChorusFlangerAudioProcessor();
 }
-
-float ChorusFlangerAudioProcessor::lin_interp(float sample_x, float sample_x1, float inPhase)
-{
-    return (1 - inPhase) * sample_x + inPhase * sample_x1; // linear interpolation
-}
@@ -9,6 +9,9 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "ChorusFlangerEngine.h"
+#include "Telemetry.h"
+#include "PresetBank.h"
 
 // Ran into issues using M_PI
 //#include <include_juce_audio_formats.cpp>
@@ -17,7 +20,17 @@
 //#  define M_PI (3.1415926536f)
 //# define _USE_MATH_DEFINES
 
-# define MAX_DELAY_TIME 2
+// Binary state header - a tag that can't start an XML state ("CFLS"), and the layout version
+# define STATE_MAGIC 0x534c4643
+# define STATE_VERSION 1
+
+// How often (Hz) the message thread checks for a preset or latency the audio thread changed
+# define PUBLISH_RATE 30
+
+// 1 builds the processor without its editor, for the console tools that link the engine library
+#ifndef CHORUSFLANGER_HEADLESS
+ # define CHORUSFLANGER_HEADLESS 0
+#endif
 
 //==============================================================================
 /**
@@ -26,6 +39,7 @@ class ChorusFlangerAudioProcessor  : public juce::AudioProcessor
                             #if JucePlugin_Enable_ARA
                              , public juce::AudioProcessorARAExtension
                             #endif
+                             , private juce::Timer
 {
 public:
     //==============================================================================
@@ -41,6 +55,14 @@ public:
    #endif
 
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+
+    // Host bypass - the wet signal fades out, then only what BypassMode asks for keeps running
+    void processBlockBypassed (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlockBypassed (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+
+    // Both host precisions run natively - the delay storage precision is a separate parameter
+    bool supportsDoublePrecisionProcessing() const override { return true; }
 
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
@@ -66,30 +88,99 @@ public:
     void setStateInformation (const void* data, int sizeInBytes) override;
 
     //==============================================================================
-    float lin_interp(float sample_x, float sample_x1, float inPhase);
+    // Selects the LFO back end (see LFO::Mode), takes effect on the next prepareToPlay
+    void setLFOMode(LFO::Mode mode, int controlRateInterval = 1);
+
+    // What keeps running while the host has the effect bypassed, once the wet signal has faded out
+    using BypassMode = ChorusFlangerEngine::BypassMode;
+
+    void setBypassMode(BypassMode mode) { mEngine.setBypassMode(mode); }
+
+    //==============================================================================
+    /* Position - a host rate sample count from 0 at prepareToPlay. While the rate holds still the LFO phase is a
+       function of the position alone, so a render can start anywhere and line up with one that ran from the top. */
+
+    // Moves the position of the next block - call between blocks, from the thread that calls processBlock
+    void seek(juce::int64 samplePosition) { mEngine.seek(samplePosition); }
+    juce::int64 getSamplePosition() const { return mEngine.getSamplePosition(); }
+
+    // Takes the position from the host's play head while it is playing, so the LFO follows the timeline. Off by
+    // default - a jump in the timeline (a loop, a locate) jumps the LFO along with it.
+    void setLFOFollowsPlayHead(bool shouldFollow) { mLFOFollowsPlayHead.store(shouldFollow, std::memory_order_relaxed); }
+
+    // Runs the input that leads up to position through the processor, throwing the output away, and leaves it at
+    // position - the delay line, feedback and filters then hold what a run from the start would, as far back as
+    // the history reaches. The parameters settle first. Allocates, so not for the audio thread.
+    void prime(const juce::AudioBuffer<float>& history, juce::int64 position);
+    void prime(const juce::AudioBuffer<double>& history, juce::int64 position);
+
+    // Telemetry for the editor - only gathered while enabled, so a closed editor costs the audio thread nothing
+    void setTelemetryEnabled(bool enabled) { mTelemetryEnabled.store(enabled, std::memory_order_relaxed); }
+    TelemetryFifo& getTelemetry() { return mTelemetry; }
+
+    // Stage timings of the audio thread - only recorded in profiling builds
+    Profiler& getProfiler() { return mEngine.getProfiler(); }
 
 private:
 
+    // processBlock and processBlockBypassed for either host precision
+    template <typename SampleType>
+    void process(juce::AudioBuffer<SampleType>& buffer, bool bypassed);
+
+    ChorusFlangerParameters getParameterValues() const; // every parameter's current value, for the engine - a preset's until it is published
+
+    template <typename SampleType>
+    void primeFrom(const juce::AudioBuffer<SampleType>& history, juce::int64 position);
+
+    void updatePlayHeadPosition(); // seeks the engine to the play head's position, when following it
+
+    /* Preset switching - setCurrentProgram only posts the request, the audio thread ducks the wet signal out,
+       jumps the engine to the preset while it is silent, then brings it back. All the audio thread does after
+       that is store the preset in mPublishingProgram - the timer sets the parameters (and tells the host) on
+       the message thread, so nothing on the audio thread locks or allocates. */
+    void updatePresetSwitch(); // once per block, moves a pending switch along
+    void applyPreset(int program); // jumps the engine to a preset, and leaves it for publishPreset
+    void publishPreset(); // message thread - sets the parameters to the applied preset
+    void publishLatency(); // message thread - tells the host the latency the audio thread last saw
+    void timerCallback() override; // message thread, PUBLISH_RATE times a second
+
+    // Adds the block to the telemetry interval, and sends a frame when the interval is up
+    template <typename SampleType>
+    void sendTelemetry(const juce::AudioBuffer<SampleType>& buffer, int numChannels);
+
     /* Parameter Declarations */
     AudioParameterFloat* mDryWetParameter; // Controls the mix of dry/wet signal
     AudioParameterFloat* mDepthParameter; // Controls how wide the delay time sweeps
     AudioParameterFloat* mRateParameter; // Controls how quickly delay time sweeps
-    AudioParameterFloat* mPhaseOffsetParameter; // Controls the difference between the ReadHead position for the L and R channels
+    AudioParameterFloat* mPhaseOffsetParameter; // Controls the difference between the ReadHead position for the first and last channels
     AudioParameterFloat* mFeedbackParameter; // Controls amount of feedback
     AudioParameterInt* mTypeParameter; // Controls if hte effect will be chorus of flanger
-
-    /* Circular buffer data */
-    std::unique_ptr<float[]> mCircularBufferLeft; // smart pointer for circularbuffer to better manage data
-    std::unique_ptr<float[]> mCircularBufferRight; // smart pointer for circularbuffer to better manage data
-
-    int mCircularbufferWriteHead;
-    int mCircularBufferLength;
-
-    float mFeedbackLeft;
-    float mFeedbackRight;
-
-    /* LFO Data */
-    float mLFOPhase;
+    AudioParameterInt* mVoicesParameter; // Controls how many chorus voices each channel has
+    AudioParameterInt* mOversamplingParameter; // Controls the oversampling order of the delay core (0 = off, 1 = 2x, 2 = 4x)
+    AudioParameterInt* mInterpolationParameter; // Controls the fractional delay interpolator (linear, hermite, lagrange, thiran)
+    AudioParameterInt* mDelayPrecisionParameter; // Controls the precision the delay core stores and interpolates in (0 = 32 bit, 1 = 64 bit, 2 = 16 bit)
+
+    /* The DSP - everything that holds audio lives in here */
+    ChorusFlangerEngine mEngine;
+
+    /* Presets */
+    std::atomic<int> mCurrentProgram; // what the host sees - set as soon as a switch is asked for
+    std::atomic<int> mPendingProgram; // switch waiting for the audio thread, -1 if none
+    int mSwitchingProgram; // preset being ducked in, -1 if none
+    std::atomic<int> mPublishingProgram; // preset applied to the engine but not yet to the parameters, -1 if none
+
+    /* Latency - a new oversampling order changes it on the audio thread, the timer tells the host */
+    std::atomic<int> mLatencySamples; // the engine's latency as of the last block
+
+    /* Telemetry - written by the audio thread only, the editor reads the FIFO */
+    TelemetryFifo mTelemetry;
+    std::atomic<bool> mTelemetryEnabled; // set by the editor while it is open
+    int mTelemetryInterval; // host rate samples per frame
+    int mTelemetrySamples; // host rate samples since the last frame
+    float mTelemetryInputPeak[TELEMETRY_CHANNELS]; // loudest samples since the last frame
+    float mTelemetryOutputPeak[TELEMETRY_CHANNELS];
+
+    std::atomic<bool> mLFOFollowsPlayHead;
 
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ChorusFlangerAudioProcessor)
@@ -0,0 +1,28 @@
+/*
+  ==============================================================================
+
+    PresetBank.cpp
+    Factory presets, exposed to the host through the program API.
+
+  ==============================================================================
+*/
+
+#include "PresetBank.h"
+
+//==============================================================================
+static const Preset factoryPresets[NUM_FACTORY_PRESETS] = {
+    //  name               dry/wet  depth  rate   offset  feedback  type  voices
+    { "Init",              0.5f,    0.5f,  10.0f, 0.0f,   0.5f,     0,    1 }, // the parameter defaults
+    { "Subtle Chorus",     0.35f,   0.3f,  0.6f,  0.5f,   0.1f,     0,    2 },
+    { "Wide Ensemble",     0.5f,    0.5f,  0.4f,  1.0f,   0.2f,     0,    6 },
+    { "Lush Eight Voices", 0.6f,    0.7f,  0.25f, 0.75f,  0.3f,     0,    8 },
+    { "Vibrato",           1.0f,    0.4f,  5.0f,  0.0f,   0.0f,     0,    1 },
+    { "Jet Flanger",       0.5f,    0.9f,  0.15f, 0.0f,   0.9f,     1,    1 },
+    { "Stereo Sweep",      0.5f,    1.0f,  0.3f,  0.25f,  0.6f,     1,    1 },
+    { "Metallic",          0.5f,    0.3f,  2.0f,  0.5f,   0.95f,    1,    1 }
+};
+
+const Preset& getFactoryPreset(int index)
+{
+    return factoryPresets[jlimit(0, NUM_FACTORY_PRESETS - 1, index)];
+}
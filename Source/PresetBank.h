@@ -0,0 +1,38 @@
+/*
+  ==============================================================================
+
+    PresetBank.h
+    Factory presets, exposed to the host through the program API.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+// Presets in the factory bank
+# define NUM_FACTORY_PRESETS 8
+
+//==============================================================================
+/**
+    One sound - the musical parameters only. The engine settings (oversampling, interpolation, delay
+    precision) are left where the user put them, so switching presets never changes the latency or
+    restarts the delay core.
+
+    Plain values and a string literal, so the bank is a constant table and reading it never allocates.
+*/
+struct Preset
+{
+    const char* name;
+    float dryWet;
+    float depth;
+    float rate; // Hz
+    float phaseOffset;
+    float feedback;
+    int type; // 0 = chorus, 1 = flanger
+    int voices; // chorus only
+};
+
+// The factory bank, in program order - NUM_FACTORY_PRESETS entries
+const Preset& getFactoryPreset(int index);
@@ -0,0 +1,281 @@
+/*
+  ==============================================================================
+
+    Profiler.cpp
+    Per-stage timing of the audio thread - latency histograms, CPU load and a trace.
+
+  ==============================================================================
+*/
+
+#include "Profiler.h"
+
+//==============================================================================
+double ProfileClock::getTicksPerSecond()
+{
+    static const double ticksPerSecond = [] {
+        // Spin on the OS timer for 20 ms and count how far the counter moved
+        const int64 timerStart = Time::getHighResolutionTicks();
+        const uint64 clockStart = now();
+        const int64 timerLength = Time::secondsToHighResolutionTicks(0.02);
+
+        int64 timerEnd = timerStart;
+
+        while (timerEnd - timerStart < timerLength) {
+            timerEnd = Time::getHighResolutionTicks();
+        }
+
+        return (double)(now() - clockStart) / Time::highResolutionTicksToSeconds(timerEnd - timerStart);
+    }();
+
+    return ticksPerSecond;
+}
+
+//==============================================================================
+Profiler::Profiler()
+{
+    mTicksPerSecond = 1.0;
+    mSampleRate = 44100.0;
+    mNumTraceEvents = 0;
+    mTraceBlocks = PROFILE_TRACE_BLOCKS;
+    mTraceBlocksLeft = 0;
+    mTraceOrigin = 0;
+    mTraceState = traceIdle;
+    mResetRequested = false;
+    mBlockStart = 0;
+    mBlockDepth = 0;
+
+    clear();
+}
+
+void Profiler::prepare(double sampleRate)
+{
+    mTicksPerSecond = ProfileClock::getTicksPerSecond();
+    mSampleRate = sampleRate;
+
+    if (mTraceEvents == nullptr) {
+        mTraceEvents.malloc(PROFILE_TRACE_CAPACITY);
+    }
+
+    mNumTraceEvents = 0;
+    mTraceState = traceIdle;
+    mResetRequested = false;
+    mBlockDepth = 0;
+
+    clear();
+}
+
+void Profiler::clear() noexcept
+{
+    for (int stage = 0; stage < NUM_PROFILE_STAGES; stage++) {
+        mStageTicks[stage] = 0;
+        mMaxTicks[stage].store(0, std::memory_order_relaxed);
+
+        for (int bin = 0; bin < PROFILE_HISTOGRAM_BINS; bin++) {
+            mBins[stage][bin].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    mNumBlocks.store(0, std::memory_order_relaxed);
+    mCpuLoad.store(0.0f, std::memory_order_relaxed);
+    mPeakCpuLoad.store(0.0f, std::memory_order_relaxed);
+}
+
+//==============================================================================
+void Profiler::beginBlock() noexcept
+{
+    // A block scope inside another one is part of the outer block - one host callback, one block
+    if (mBlockDepth++ > 0) {
+        return;
+    }
+
+    if (mResetRequested.exchange(false)) {
+        clear();
+    }
+
+    // A requested trace starts on a block boundary, so it never opens halfway through a block
+    if (mTraceState.load(std::memory_order_acquire) == traceRequested && mTraceEvents != nullptr) {
+        mNumTraceEvents = 0;
+        mTraceBlocksLeft = mTraceBlocks;
+        mTraceState.store(traceCapturing, std::memory_order_relaxed);
+    }
+
+    mBlockStart = ProfileClock::now();
+
+    if (mNumTraceEvents == 0) {
+        mTraceOrigin = mBlockStart;
+    }
+}
+
+void Profiler::addStage(int stage, uint64 start, uint64 end) noexcept
+{
+    // Work outside any block (priming the delay line, say) belongs to no host callback, so it isn't counted
+    if (mBlockDepth == 0) {
+        return;
+    }
+
+    mStageTicks[stage] += end - start;
+
+    if (mTraceState.load(std::memory_order_relaxed) != traceCapturing) {
+        return;
+    }
+
+    mTraceEvents[mNumTraceEvents++] = { stage, start, end - start };
+
+    // The block event comes last in its block, so that is where the requested length runs out
+    if (stage == blockStage) {
+        mTraceBlocksLeft--;
+    }
+
+    if (mNumTraceEvents == PROFILE_TRACE_CAPACITY || mTraceBlocksLeft <= 0) {
+        mTraceState.store(traceReady, std::memory_order_release); // publishes the events to writeTrace
+    }
+}
+
+void Profiler::endBlock(int numSamples) noexcept
+{
+    if (mBlockDepth > 1) {
+        mBlockDepth--;
+        return;
+    }
+
+    addStage(blockStage, mBlockStart, ProfileClock::now());
+    mBlockDepth = 0;
+
+    // Each thread only ever writes its own atomics, so a load and a store are enough - no read-modify-write
+    for (int stage = 0; stage < NUM_PROFILE_STAGES; stage++) {
+        const uint64 ticks = mStageTicks[stage];
+        mStageTicks[stage] = 0;
+
+        auto& bin = mBins[stage][getBin(ticks)];
+        bin.store(bin.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+        if (ticks > mMaxTicks[stage].load(std::memory_order_relaxed)) {
+            mMaxTicks[stage].store(ticks, std::memory_order_relaxed);
+        }
+    }
+
+    mNumBlocks.store(mNumBlocks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    // CPU load - the block's processing time against the time it covers
+    if (numSamples > 0) {
+        const double seconds = (double)(ProfileClock::now() - mBlockStart) / mTicksPerSecond;
+        const float load = (float)(seconds * mSampleRate / numSamples);
+        const float smoothedLoad = mCpuLoad.load(std::memory_order_relaxed);
+
+        mCpuLoad.store(smoothedLoad + PROFILE_LOAD_SMOOTHING * (load - smoothedLoad), std::memory_order_relaxed);
+
+        if (load > mPeakCpuLoad.load(std::memory_order_relaxed)) {
+            mPeakCpuLoad.store(load, std::memory_order_relaxed);
+        }
+    }
+}
+
+//==============================================================================
+ProfileStats Profiler::getStats(int stage) const
+{
+    // Copy the bins first, so the percentiles are worked out from one consistent count
+    uint32 bins[PROFILE_HISTOGRAM_BINS];
+    uint64 numBlocks = 0;
+
+    for (int bin = 0; bin < PROFILE_HISTOGRAM_BINS; bin++) {
+        bins[bin] = mBins[stage][bin].load(std::memory_order_relaxed);
+        numBlocks += bins[bin];
+    }
+
+    const double microsecondsPerTick = 1.0e6 / mTicksPerSecond;
+
+    // Each percentile is the upper edge of the bin it falls in - at most a quarter octave pessimistic
+    auto getPercentile = [&](double fraction) {
+        const uint64 rank = jmax((uint64)1, (uint64)std::ceil(fraction * (double)numBlocks));
+        uint64 count = 0;
+
+        for (int bin = 0; bin < PROFILE_HISTOGRAM_BINS; bin++) {
+            count += bins[bin];
+
+            if (count >= rank) {
+                return (double)getBinUpperEdge(bin) * microsecondsPerTick;
+            }
+        }
+
+        return 0.0;
+    };
+
+    ProfileStats stats;
+    stats.numBlocks = numBlocks;
+    stats.p50 = (numBlocks > 0) ? getPercentile(0.5) : 0.0;
+    stats.p99 = (numBlocks > 0) ? getPercentile(0.99) : 0.0;
+    stats.max = (double)mMaxTicks[stage].load(std::memory_order_relaxed) * microsecondsPerTick;
+
+    return stats;
+}
+
+int Profiler::getBin(uint64 ticks) noexcept
+{
+    if (ticks < 4) {
+        return (int)ticks;
+    }
+
+    // Octave, then which quarter of it - the two bits below the top one
+    int octave = 0;
+
+    for (uint64 value = ticks; value > 1; value >>= 1) {
+        octave++;
+    }
+
+    return octave * 4 + (int)((ticks >> (octave - 2)) & 3);
+}
+
+uint64 Profiler::getBinUpperEdge(int bin) noexcept
+{
+    if (bin < 4) {
+        return (uint64)bin;
+    }
+
+    const int octave = bin / 4;
+    const uint64 quarter = (uint64)(bin % 4);
+
+    return ((4 + quarter + 1) << (octave - 2)) - 1;
+}
+
+//==============================================================================
+void Profiler::requestTrace(int numBlocks)
+{
+    // A trace that is already asked for or being captured runs to the end, a finished one is replaced
+    int state = mTraceState.load();
+
+    if (state == traceIdle || state == traceReady) {
+        mTraceBlocks = jmax(1, numBlocks);
+        mTraceState.compare_exchange_strong(state, traceRequested); // publishes mTraceBlocks to the audio thread
+    }
+}
+
+bool Profiler::writeTrace(OutputStream& stream) const
+{
+    if (! isTraceReady()) {
+        return false;
+    }
+
+    // Chrome trace event format - one complete ("X") event per stage call, in microseconds since the first block
+    const double microsecondsPerTick = 1.0e6 / mTicksPerSecond;
+
+    stream << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+
+    for (int index = 0; index < mNumTraceEvents; index++) {
+        const TraceEvent& event = mTraceEvents[index];
+
+        stream << "{\"name\":\"" << getStageName(event.stage) << "\",\"cat\":\"dsp\",\"ph\":\"X\",\"pid\":1,\"tid\":1"
+               << ",\"ts\":" << String((double)(event.start - mTraceOrigin) * microsecondsPerTick, 3)
+               << ",\"dur\":" << String((double)event.duration * microsecondsPerTick, 3)
+               << ((index + 1 < mNumTraceEvents) ? "},\n" : "}\n");
+    }
+
+    stream << "]}\n";
+    return true;
+}
+
+const char* Profiler::getStageName(int stage)
+{
+    static const char* const names[NUM_PROFILE_STAGES] = { "modulation", "read", "write", "mix", "oversampling", "block" };
+
+    return names[jlimit(0, NUM_PROFILE_STAGES - 1, stage)];
+}
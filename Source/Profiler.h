@@ -0,0 +1,201 @@
+/*
+  ==============================================================================
+
+    Profiler.h
+    Per-stage timing of the audio thread - latency histograms, CPU load and a trace.
+
+    Only timed when CHORUSFLANGER_PROFILING is 1 (the Profile configurations set it) -
+    otherwise the PROFILE_ macros expand to nothing and the profiler never records. The
+    classes themselves are always there, so the engine is laid out the same either way and
+    a tool built with one setting can link an engine library built with the other.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "EngineModules.h"
+
+#ifndef CHORUSFLANGER_PROFILING
+ # define CHORUSFLANGER_PROFILING 0
+#endif
+
+#if JUCE_INTEL
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+// Histogram bins - four per power of two of the cycle count, which covers every count a uint64 can hold
+# define PROFILE_HISTOGRAM_BINS 256
+
+// Stage events one trace can hold - a few thousand blocks, depending on the tile count
+# define PROFILE_TRACE_CAPACITY 65536
+
+// Blocks a trace covers unless asked for another length (about a second at 48 kHz and 256 samples)
+# define PROFILE_TRACE_BLOCKS 200
+
+// Weight of each block in the smoothed CPU load
+# define PROFILE_LOAD_SMOOTHING 0.05f
+
+// Timed stages - the delay core's, then the work around it, then the whole block
+enum ProfileStage
+{
+    modulationStage = 0, // LFO and read head positions
+    readStage, // interpolated reads and the voice sum
+    writeStage, // feedback and the delay line write
+    mixStage, // dry/wet mix, including the dry delay when oversampling
+    oversamplingStage, // up and down sampling filters
+    blockStage, // all of processBlock
+    NUM_PROFILE_STAGES
+};
+
+//==============================================================================
+// Cheapest monotonic counter on this CPU - the time stamp counter, the ARM virtual counter, or the OS timer
+struct ProfileClock
+{
+    static uint64 now() noexcept
+    {
+       #if JUCE_INTEL
+        return (uint64)__rdtsc();
+       #elif JUCE_ARM && JUCE_64BIT && ! JUCE_MSVC
+        uint64 value;
+        asm volatile("mrs %0, cntvct_el0" : "=r"(value));
+        return value;
+       #else
+        return (uint64)Time::getHighResolutionTicks();
+       #endif
+    }
+
+    // Counter ticks per second, measured against the OS timer the first time it is asked for (takes 20 ms)
+    static double getTicksPerSecond();
+};
+
+// Latency of one stage, in microseconds per block
+struct ProfileStats
+{
+    uint64 numBlocks;
+    double p50;
+    double p99;
+    double max;
+};
+
+//==============================================================================
+/**
+    Times the stages of the audio thread.
+
+    The audio thread is the only writer - it adds each stage's ticks up over a block, and at the end of the
+    block bins the totals into per-stage histograms of atomics. Only the outermost block scope counts, and
+    stages timed outside every block scope are dropped. Any other thread can read percentiles and
+    the CPU load at any time without locking; a read during a write is at most one block out of date.
+
+    A trace is captured on request: the audio thread fills a preallocated buffer with one event per stage
+    call for the blocks asked for, then marks it ready for writeTrace to turn into Chrome/Perfetto trace
+    event JSON.
+*/
+class Profiler
+{
+public:
+    Profiler();
+
+    // Message thread - allocates the trace buffer and clears everything
+    void prepare(double sampleRate);
+
+    /* Audio thread */
+    void beginBlock() noexcept;
+    void endBlock(int numSamples) noexcept;
+    void addStage(int stage, uint64 start, uint64 end) noexcept;
+
+    /* Any thread */
+    ProfileStats getStats(int stage) const;
+    float getCpuLoad() const { return mCpuLoad.load(std::memory_order_relaxed); } // share of the block's real time, smoothed
+    float getPeakCpuLoad() const { return mPeakCpuLoad.load(std::memory_order_relaxed); }
+    void reset() { mResetRequested = true; } // the audio thread clears the statistics at its next block
+    void requestTrace(int numBlocks = PROFILE_TRACE_BLOCKS); // captures the next blocks, or as many as fit
+    bool isTraceReady() const { return mTraceState.load(std::memory_order_acquire) == traceReady; }
+    bool writeTrace(OutputStream& stream) const; // false if no trace is ready
+
+    static const char* getStageName(int stage);
+
+private:
+    struct TraceEvent
+    {
+        int stage;
+        uint64 start;
+        uint64 duration;
+    };
+
+    enum TraceState { traceIdle = 0, traceRequested, traceCapturing, traceReady };
+
+    void clear() noexcept;
+
+    static int getBin(uint64 ticks) noexcept;
+    static uint64 getBinUpperEdge(int bin) noexcept;
+
+    double mTicksPerSecond;
+    double mSampleRate;
+
+    /* Audio thread only */
+    uint64 mBlockStart;
+    int mBlockDepth; // block scopes open - stages only count inside one
+    uint64 mStageTicks[NUM_PROFILE_STAGES]; // this block's total per stage so far
+
+    /* Written by the audio thread, read by anyone */
+    std::atomic<uint32> mBins[NUM_PROFILE_STAGES][PROFILE_HISTOGRAM_BINS];
+    std::atomic<uint64> mMaxTicks[NUM_PROFILE_STAGES];
+    std::atomic<uint64> mNumBlocks;
+    std::atomic<float> mCpuLoad;
+    std::atomic<float> mPeakCpuLoad;
+    std::atomic<bool> mResetRequested;
+
+    /* Trace */
+    HeapBlock<TraceEvent> mTraceEvents;
+    int mNumTraceEvents;
+    int mTraceBlocks; // blocks asked for, set before the request is published
+    int mTraceBlocksLeft;
+    uint64 mTraceOrigin; // timestamp of the first captured block
+    std::atomic<int> mTraceState;
+
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Profiler)
+};
+
+//==============================================================================
+// Times the scope it is declared in as one call of a stage
+class ScopedStageTimer
+{
+public:
+    ScopedStageTimer(Profiler& profiler, int stage) noexcept : mProfiler(profiler), mStage(stage), mStart(ProfileClock::now()) {}
+    ~ScopedStageTimer() { mProfiler.addStage(mStage, mStart, ProfileClock::now()); }
+
+private:
+    Profiler& mProfiler;
+    int mStage;
+    uint64 mStart;
+};
+
+// Times the scope it is declared in as one processBlock, however it returns
+class ScopedBlockTimer
+{
+public:
+    ScopedBlockTimer(Profiler& profiler, int numSamples) noexcept : mProfiler(profiler), mNumSamples(numSamples) { mProfiler.beginBlock(); }
+    ~ScopedBlockTimer() { mProfiler.endBlock(mNumSamples); }
+
+private:
+    Profiler& mProfiler;
+    int mNumSamples;
+};
+
+#if CHORUSFLANGER_PROFILING
+
+ # define PROFILE_STAGE(profiler, stage) ScopedStageTimer JUCE_JOIN_MACRO(stageTimer, __LINE__)(profiler, stage)
+ # define PROFILE_BLOCK(profiler, numSamples) ScopedBlockTimer JUCE_JOIN_MACRO(blockTimer, __LINE__)(profiler, numSamples)
+
+#else
+
+ # define PROFILE_STAGE(profiler, stage)
+ # define PROFILE_BLOCK(profiler, numSamples)
+
+#endif
@@ -0,0 +1,444 @@
+/*
+  ==============================================================================
+
+    StreamBank.cpp
+    Many independent chorus/flanger streams, processed together on a pool of threads.
+
+  ==============================================================================
+*/
+
+#include "StreamBank.h"
+#include "ChorusFlangerEngine.h" // delay ranges and limits, shared with the plugin
+
+//==============================================================================
+// One pool thread - waits for a tick, works through chunks until none are left, and waits again
+class StreamBank::Worker : public Thread
+{
+public:
+    Worker(StreamBank& bank, int index) : Thread("Stream bank worker"), mBank(bank), mIndex(index) {}
+
+    ~Worker() override
+    {
+        signalThreadShouldExit();
+        mTick.signal();
+        stopThread(1000);
+    }
+
+    void startTick() { mTick.signal(); }
+
+    void run() override
+    {
+        while (! threadShouldExit()) {
+            mTick.wait(-1);
+
+            if (threadShouldExit()) {
+                break;
+            }
+
+            mBank.runChunks(mIndex);
+        }
+    }
+
+private:
+    StreamBank& mBank;
+    int mIndex;
+    WaitableEvent mTick;
+};
+
+//==============================================================================
+StreamBank::StreamBank()
+{
+    mNumStreams = 0;
+    mNumChannels = 0;
+    mSampleRate = 44100.0;
+    mMaximumBlockSize = 0;
+    mNumThreads = 0;
+    mNumChunks = 0;
+    mTileSize = 1;
+
+    mPhase = nullptr;
+    mWritePosition = nullptr;
+    mType = nullptr;
+    mRate = nullptr;
+    mPhaseOffset = nullptr;
+    mDryWet = nullptr;
+    mDepth = nullptr;
+    mFeedback = nullptr;
+    mFeedbackCarry = nullptr;
+    mDelayMemory = nullptr;
+    mLineStride = 0;
+    mLineLength = 0;
+    mLineMask = 0;
+
+    mChannels = nullptr;
+    mTickSamples = 0;
+    mDeadline = 0;
+    mChunksDone = 0;
+    mNumSkipped = 0;
+}
+
+StreamBank::~StreamBank()
+{
+    release();
+}
+
+template <typename Type>
+size_t StreamBank::getArrayBytes(size_t count)
+{
+    return (count * sizeof(Type) + STREAM_BANK_ALIGNMENT - 1) / STREAM_BANK_ALIGNMENT * STREAM_BANK_ALIGNMENT;
+}
+
+template <typename Type>
+Type* StreamBank::allocateArray(char*& memory, size_t count)
+{
+    // Never destroyed - release just frees the block, so only types that need no destructor go in it
+    static_assert(std::is_trivially_destructible<Type>::value, "the bank's memory is freed without destroying its contents");
+
+    Type* array = (Type*)memory;
+    memory += getArrayBytes<Type>(count);
+
+    // The block is calloc'ed, which already makes the plain arrays zero
+    if constexpr (! std::is_trivially_default_constructible<Type>::value) {
+        for (size_t i = 0; i < count; i++) {
+            new (array + i) Type();
+        }
+    }
+
+    return array;
+}
+
+void StreamBank::prepare(int numStreams, int numChannels, double sampleRate, int maximumBlockSize, int numThreads)
+{
+    release();
+
+    mNumStreams = jmax(0, numStreams);
+    mNumChannels = jlimit(1, MAX_CHANNELS, numChannels);
+    mSampleRate = sampleRate;
+    mMaximumBlockSize = maximumBlockSize;
+    mNumChunks = (mNumStreams + STREAM_CHUNK_SIZE - 1) / STREAM_CHUNK_SIZE;
+    mNumThreads = jlimit(1, jmax(1, mNumChunks), (numThreads > 0) ? numThreads : SystemStats::getNumCpus());
+
+    // Every stream reads before it writes each sample, so the line only has to cover the longest delay
+    mLineLength = nextPowerOfTwo((int)std::ceil(sampleRate * MAX_DELAY_TIME) + INTERPOLATION_MARGIN);
+    mLineMask = mLineLength - 1;
+    mLineStride = getArrayBytes<float>((size_t)mLineLength * mNumChannels) / sizeof(float);
+
+    // The engine's tile length at 1x - the rate and phase offset move in the same steps
+    mTileSize = jlimit(1, MAX_TILE_SIZE, (int)(sampleRate * MIN_DELAY_TIME) - 1 - INTERPOLATION_LOOKAHEAD);
+
+    // One block for everything, each array starting on its own cache line
+    const size_t numSlots = (size_t)mNumChunks * STREAM_CHUNK_SIZE;
+    const size_t arrayBytes = getArrayBytes<double>(numSlots) + getArrayBytes<int>(numSlots) * 2
+                              + getArrayBytes<SmoothedValue<float, ValueSmoothingTypes::Multiplicative>>(numSlots)
+                              + getArrayBytes<SmoothedValue<float>>(numSlots) * 4
+                              + getArrayBytes<float>(numSlots * mNumChannels);
+    const size_t delayBytes = numSlots * mLineStride * sizeof(float);
+
+    mMemory.calloc(arrayBytes + delayBytes + STREAM_BANK_ALIGNMENT);
+
+    char* memory = mMemory.get() + (STREAM_BANK_ALIGNMENT - (size_t)mMemory.get() % STREAM_BANK_ALIGNMENT) % STREAM_BANK_ALIGNMENT;
+
+    mPhase = allocateArray<double>(memory, numSlots);
+    mWritePosition = allocateArray<int>(memory, numSlots);
+    mType = allocateArray<int>(memory, numSlots);
+    mRate = allocateArray<SmoothedValue<float, ValueSmoothingTypes::Multiplicative>>(memory, numSlots);
+    mPhaseOffset = allocateArray<SmoothedValue<float>>(memory, numSlots);
+    mDryWet = allocateArray<SmoothedValue<float>>(memory, numSlots);
+    mDepth = allocateArray<SmoothedValue<float>>(memory, numSlots);
+    mFeedback = allocateArray<SmoothedValue<float>>(memory, numSlots);
+    mFeedbackCarry = allocateArray<float>(memory, numSlots * mNumChannels);
+    mDelayMemory = allocateArray<float>(memory, numSlots * mLineStride);
+
+    for (int stream = 0; stream < mNumStreams; stream++) {
+        mRate[stream].reset(sampleRate, PARAMETER_SMOOTHING_TIME);
+        mPhaseOffset[stream].reset(sampleRate, PARAMETER_SMOOTHING_TIME);
+        mDryWet[stream].reset(sampleRate, PARAMETER_SMOOTHING_TIME);
+        mDepth[stream].reset(sampleRate, PARAMETER_SMOOTHING_TIME);
+        mFeedback[stream].reset(sampleRate, PARAMETER_SMOOTHING_TIME);
+
+        setParameters(stream, StreamParameters());
+        reset(stream);
+    }
+
+    // Split the chunks evenly between the threads
+    mRanges.reset(new ChunkRange[(size_t)mNumThreads]);
+
+    for (int thread = 0; thread < mNumThreads; thread++) {
+        mRanges[thread].begin = mNumChunks * thread / mNumThreads;
+        mRanges[thread].end = mNumChunks * (thread + 1) / mNumThreads;
+        mRanges[thread].next = mRanges[thread].end; // closed until the first tick
+    }
+
+    for (int thread = 1; thread < mNumThreads; thread++) {
+        mWorkers.add(new Worker(*this, thread))->startThread();
+    }
+}
+
+void StreamBank::release()
+{
+    mWorkers.clear(); // stops the threads
+    mRanges.reset();
+    mMemory.free();
+
+    mNumStreams = 0;
+    mNumThreads = 0;
+    mNumChunks = 0;
+}
+
+void StreamBank::reset(int stream)
+{
+    jassert(stream >= 0 && stream < mNumStreams);
+
+    mPhase[stream] = 0.0;
+    mWritePosition[stream] = 0;
+
+    // Start at the parameters, without gliding to them
+    mRate[stream].setCurrentAndTargetValue(mRate[stream].getTargetValue());
+    mPhaseOffset[stream].setCurrentAndTargetValue(mPhaseOffset[stream].getTargetValue());
+    mDryWet[stream].setCurrentAndTargetValue(mDryWet[stream].getTargetValue());
+    mDepth[stream].setCurrentAndTargetValue(mDepth[stream].getTargetValue());
+    mFeedback[stream].setCurrentAndTargetValue(mFeedback[stream].getTargetValue());
+
+    FloatVectorOperations::clear(mFeedbackCarry + stream * mNumChannels, mNumChannels);
+    FloatVectorOperations::clear(mDelayMemory + stream * mLineStride, mLineLength * mNumChannels);
+}
+
+void StreamBank::setParameters(int stream, const StreamParameters& parameters)
+{
+    jassert(stream >= 0 && stream < mNumStreams);
+
+    // Clamped as the engine clamps its parameters
+    ChorusFlangerParameters limited;
+    limited.dryWet = parameters.dryWet;
+    limited.depth = parameters.depth;
+    limited.rate = parameters.rate;
+    limited.phaseOffset = parameters.phaseOffset;
+    limited.feedback = parameters.feedback;
+    limited.type = parameters.type;
+    limited = limited.limited();
+
+    mDryWet[stream].setTargetValue(limited.dryWet);
+    mDepth[stream].setTargetValue(limited.depth);
+    mRate[stream].setTargetValue(limited.rate);
+    mPhaseOffset[stream].setTargetValue(limited.phaseOffset);
+    mFeedback[stream].setTargetValue(limited.feedback);
+    mType[stream] = limited.type;
+}
+
+//==============================================================================
+StreamTickStats StreamBank::process(float* const* const* channels, int numSamples, double deadlineSeconds)
+{
+    jassert(numSamples <= mMaximumBlockSize);
+
+    const int64 start = Time::getHighResolutionTicks();
+
+    StreamTickStats stats;
+    stats.numProcessed = 0;
+    stats.numSkipped = 0;
+    stats.seconds = 0.0;
+
+    if (mNumChunks == 0 || numSamples <= 0) {
+        return stats;
+    }
+
+    // Publish the tick, then open the ranges - claiming a chunk reads the ranges, so it sees the tick too
+    mChannels = channels;
+    mTickSamples = numSamples;
+    mDeadline = (deadlineSeconds > 0.0) ? start + Time::secondsToHighResolutionTicks(deadlineSeconds) : 0;
+    mChunksDone = 0;
+    mNumSkipped = 0;
+
+    for (int thread = 0; thread < mNumThreads; thread++) {
+        mRanges[thread].next.store(mRanges[thread].begin, std::memory_order_release);
+    }
+
+    for (auto* worker : mWorkers) {
+        worker->startTick();
+    }
+
+    runChunks(0);
+
+    // Only chunks already being processed by other threads are left
+    while (mChunksDone.load(std::memory_order_acquire) < mNumChunks) {
+        Thread::yield();
+    }
+
+    stats.numSkipped = mNumSkipped.load();
+    stats.numProcessed = mNumStreams - stats.numSkipped;
+    stats.seconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start);
+
+    return stats;
+}
+
+void StreamBank::runChunks(int thread)
+{
+    juce::ScopedNoDenormals noDenormals;
+
+    // The thread's own range first, then the others' in turn - everyone claims from the front of a range
+    for (int offset = 0; offset < mNumThreads; offset++) {
+        ChunkRange& range = mRanges[(thread + offset) % mNumThreads];
+
+        for (int chunk = range.next++; chunk < range.end; chunk = range.next++) {
+            const int firstStream = chunk * STREAM_CHUNK_SIZE;
+            const int lastStream = jmin(firstStream + STREAM_CHUNK_SIZE, mNumStreams);
+            const bool late = (mDeadline != 0 && Time::getHighResolutionTicks() > mDeadline);
+
+            for (int stream = firstStream; stream < lastStream; stream++) {
+                if (late) {
+                    skipStream(stream, mTickSamples);
+                }
+                else {
+                    processStream(stream, mChannels[stream], mTickSamples);
+                }
+            }
+
+            if (late) {
+                mNumSkipped += lastStream - firstStream;
+            }
+
+            mChunksDone.fetch_add(1, std::memory_order_release);
+        }
+    }
+}
+
+// Writes the next numSamples values of a smoothed parameter into dest
+static void fillRamp(SmoothedValue<float>& smoothedValue, float* dest, int numSamples)
+{
+    if (! smoothedValue.isSmoothing()) {
+        FloatVectorOperations::fill(dest, smoothedValue.getTargetValue(), numSamples);
+        return;
+    }
+
+    for (int i = 0; i < numSamples; i++) {
+        dest[i] = smoothedValue.getNextValue();
+    }
+}
+
+void StreamBank::processStream(int stream, float* const* channels, int numSamples)
+{
+    const int numChannels = mNumChannels;
+    const float sampleRate = (float)mSampleRate;
+
+    // Delay range of the type, as in the engine
+    const float minDelayTime = (mType[stream] == 0) ? CHORUS_MIN_DELAY_TIME : FLANGER_MIN_DELAY_TIME;
+    const float maxDelayTime = (mType[stream] == 0) ? CHORUS_MAX_DELAY_TIME : FLANGER_MAX_DELAY_TIME;
+    const float centre = 0.5f * (minDelayTime + maxDelayTime) * sampleRate;
+    const float sweep = 0.5f * (maxDelayTime - minDelayTime) * sampleRate;
+
+    float* line = mDelayMemory + stream * mLineStride;
+    float* feedbackCarry = mFeedbackCarry + stream * numChannels;
+    const int mask = mLineMask;
+    int writePosition = mWritePosition[stream];
+
+    // Each channel's share of the phase offset, as a fixed rotation of the LFO - worked out again when the offset moves
+    float offsetSin[MAX_CHANNELS], offsetCos[MAX_CHANNELS];
+    float offsetRotated = -1.0f;
+
+    float dryWetRamp[MAX_TILE_SIZE], depthRamp[MAX_TILE_SIZE], feedbackRamp[MAX_TILE_SIZE];
+
+    for (int tileStart = 0; tileStart < numSamples; tileStart += mTileSize) {
+        const int tileLength = jmin(mTileSize, numSamples - tileStart);
+
+        // Rate and phase offset move at tile rate, the rest every sample - as in the engine
+        const float rate = mRate[stream].getCurrentValue();
+        mRate[stream].skip(tileLength);
+
+        const float phaseOffset = mPhaseOffset[stream].getCurrentValue();
+        mPhaseOffset[stream].skip(tileLength);
+
+        if (phaseOffset != offsetRotated) {
+            for (int channel = 0; channel < numChannels; channel++) {
+                float channelOffset = (numChannels > 1) ? phaseOffset * channel / (numChannels - 1) : 0.0f;
+                offsetSin[channel] = std::sin(MathConstants<float>::twoPi * channelOffset);
+                offsetCos[channel] = std::cos(MathConstants<float>::twoPi * channelOffset);
+            }
+
+            offsetRotated = phaseOffset;
+        }
+
+        fillRamp(mDryWet[stream], dryWetRamp, tileLength);
+        fillRamp(mDepth[stream], depthRamp, tileLength);
+        fillRamp(mFeedback[stream], feedbackRamp, tileLength);
+        FloatVectorOperations::multiply(depthRamp, sweep, tileLength);
+
+        // The read heads follow the same cubic as the engine's, through the exact delay times at a few samples
+        // of the tile - the LFO is only worked out at those
+        const double phase = mPhase[stream];
+        const double increment = (double)rate / mSampleRate;
+
+        const double nextPhase = phase + increment * tileLength;
+        mPhase[stream] = nextPhase - std::floor(nextPhase);
+
+        int points[MODULATION_CURVE_POINTS];
+        const int numPoints = ChorusFlangerEngine::getModulationCurvePoints(tileLength, points);
+        float lfoSin[MODULATION_CURVE_POINTS], lfoCos[MODULATION_CURVE_POINTS];
+
+        for (int point = 0; point < numPoints; point++) {
+            lfoSin[point] = (float)std::sin(MathConstants<double>::twoPi * (phase + increment * points[point]));
+            lfoCos[point] = (float)std::cos(MathConstants<double>::twoPi * (phase + increment * points[point]));
+        }
+
+        int64 differences[MAX_CHANNELS][MODULATION_CURVE_POINTS];
+
+        for (int channel = 0; channel < numChannels; channel++) {
+            double curve[MODULATION_CURVE_POINTS];
+
+            for (int point = 0; point < numPoints; point++) {
+                double lfo = (double)lfoSin[point] * offsetCos[channel] + (double)lfoCos[point] * offsetSin[channel];
+                curve[point] = centre + lfo * depthRamp[points[point]];
+            }
+
+            ChorusFlangerEngine::fitModulationCurve(curve, points, numPoints, differences[channel]);
+        }
+
+        for (int i = 0; i < tileLength; i++) {
+            const int sample = tileStart + i;
+
+            for (int channel = 0; channel < numChannels; channel++) {
+                int64* difference = differences[channel];
+
+                // Linear interpolation between the two frames either side of the read head, as the engine's
+                int delay;
+                float frac;
+                LinearInterpolator::split(difference[0], delay, frac);
+
+                difference[0] += difference[1];
+                difference[1] += difference[2];
+                difference[2] += difference[3];
+
+                float newer = line[((writePosition - delay) & mask) * numChannels + channel];
+                float older = line[((writePosition - delay - 1) & mask) * numChannels + channel];
+                float wet = newer + frac * (older - newer);
+
+                // The written sample gets the previous delayed sample's feedback, and this one's goes into the next
+                float dry = channels[channel][sample];
+                line[writePosition * numChannels + channel] = dry + feedbackCarry[channel];
+                feedbackCarry[channel] = wet * feedbackRamp[i];
+                channels[channel][sample] = dry + dryWetRamp[i] * (wet - dry);
+            }
+
+            writePosition = (writePosition + 1) & mask;
+        }
+    }
+
+    mWritePosition[stream] = writePosition;
+}
+
+void StreamBank::skipStream(int stream, int numSamples)
+{
+    // The buffer already holds the dry input - only the LFO and the parameters move on, in the same steps as
+    // processStream so they stay in time. The delay line misses the tick, which is heard as a short gap in the
+    // wet signal one delay time later.
+    for (int tileStart = 0; tileStart < numSamples; tileStart += mTileSize) {
+        const int tileLength = jmin(mTileSize, numSamples - tileStart);
+
+        const double nextPhase = mPhase[stream] + (double)mRate[stream].getCurrentValue() * tileLength / mSampleRate;
+        mPhase[stream] = nextPhase - std::floor(nextPhase);
+        mRate[stream].skip(tileLength);
+    }
+
+    mPhaseOffset[stream].skip(numSamples);
+    mDryWet[stream].skip(numSamples);
+    mDepth[stream].skip(numSamples);
+    mFeedback[stream].skip(numSamples);
+}
@@ -0,0 +1,149 @@
+/*
+  ==============================================================================
+
+    StreamBank.h
+    Many independent chorus/flanger streams, processed together on a pool of threads.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "EngineModules.h"
+
+// Streams a worker claims at a time - 16 floats fill a cache line, so two workers never write the same line
+// of a state array
+# define STREAM_CHUNK_SIZE 16
+
+// Alignment of every state array and delay line (bytes)
+# define STREAM_BANK_ALIGNMENT 64
+
+//==============================================================================
+// One stream's settings - the plugin's musical parameters, with the same ranges and defaults (clamped the same way)
+struct StreamParameters
+{
+    float dryWet = 0.5f;
+    float depth = 0.5f;
+    float rate = 10.0f; // Hz
+    float phaseOffset = 0.0f;
+    float feedback = 0.5f;
+    int type = 0; // 0 = chorus, 1 = flanger
+};
+
+// What happened in one tick
+struct StreamTickStats
+{
+    int numProcessed;
+    int numSkipped; // missed the deadline - passed through dry
+    double seconds; // wall time of the tick
+};
+
+//==============================================================================
+/**
+    A bank of streams sharing one sample rate, channel count and block size.
+
+    Each stream runs the signal path ChorusFlangerEngine takes at one voice, linear interpolation, no
+    oversampling and 32-bit delay storage - the same delay ranges, feedback timing (every written sample
+    gets the previous delayed sample's feedback), parameter smoothing and read heads (the engine's cubic
+    fit, in tiles of the same length). The per-sample loop is the bank's own, over the bank's memory, and
+    skips what the engine adds on top (silence detection, bypass, the position-locked LFO, preset ducking).
+    A stream matches an engine at those settings to within rounding - the engine's LFO is a float rotor,
+    where a stream works the LFO out exactly at the samples the read heads are fitted through.
+
+    All streams' state lives in one allocation, as arrays over the streams (LFO phases, write positions,
+    smoothed parameters, feedback, then the delay lines), so a worker running through its streams reads
+    memory front to back.
+
+    A tick hands over one buffer per stream and processes them all in place. The streams are split into
+    chunks, and every thread owns a range of chunks - the same range every tick, so its streams stay in its
+    cache. A thread that runs out of its own chunks takes chunks from the others', so a slow core or a
+    preempted thread holds nobody up. The calling thread works as one of the threads.
+
+    With a deadline, chunks claimed after it has passed are passed through dry instead of processed, with
+    their LFOs moved on so they stay in time. The tick then returns on time with the missed streams counted.
+*/
+class StreamBank
+{
+public:
+    StreamBank();
+    ~StreamBank();
+
+    //==============================================================================
+    // Allocates everything and starts the threads - numThreads 0 means one per core, including the caller
+    void prepare(int numStreams, int numChannels, double sampleRate, int maximumBlockSize, int numThreads = 0);
+
+    // Stops the threads and frees the memory
+    void release();
+
+    // Clears a stream's delay line and restarts its LFO, for a new stream taking over the slot
+    void reset(int stream);
+
+    // Glided to from the next tick on, over PARAMETER_SMOOTHING_TIME as in the engine (the type switches at once) -
+    // call between ticks, from the thread that calls process
+    void setParameters(int stream, const StreamParameters& parameters);
+
+    //==============================================================================
+    // Processes one tick in place - channels[stream][channel] - and returns once every stream is done.
+    // deadlineSeconds from the start of the call, 0 for none.
+    StreamTickStats process(float* const* const* channels, int numSamples, double deadlineSeconds = 0.0);
+
+    int getNumStreams() const { return mNumStreams; }
+    int getNumThreads() const { return mNumThreads; }
+
+private:
+    class Worker;
+
+    // A thread's range of chunks - the owner and thieves all claim from next
+    struct alignas(STREAM_BANK_ALIGNMENT) ChunkRange
+    {
+        std::atomic<int> next;
+        int begin;
+        int end;
+    };
+
+    template <typename Type>
+    static size_t getArrayBytes(size_t count); // an array's share of mMemory, rounded up to STREAM_BANK_ALIGNMENT
+    template <typename Type>
+    Type* allocateArray(char*& memory, size_t count); // carves an aligned array out of mMemory, constructing its entries
+
+    void runChunks(int thread); // the thread's own chunks, then everyone else's
+    void processStream(int stream, float* const* channels, int numSamples);
+    void skipStream(int stream, int numSamples);
+
+    int mNumStreams;
+    int mNumChannels;
+    double mSampleRate;
+    int mMaximumBlockSize;
+    int mNumThreads;
+    int mNumChunks;
+    int mTileSize; // samples the rate and phase offset hold still for - the engine's tile length at this rate
+
+    /* State, one entry per stream */
+    HeapBlock<char> mMemory;
+    double* mPhase; // LFO phase, in cycles
+    int* mWritePosition;
+    int* mType;
+    SmoothedValue<float, ValueSmoothingTypes::Multiplicative>* mRate; // moved once per tile, like the phase offset
+    SmoothedValue<float>* mPhaseOffset;
+    SmoothedValue<float>* mDryWet; // moved every sample
+    SmoothedValue<float>* mDepth;
+    SmoothedValue<float>* mFeedback;
+    float* mFeedbackCarry; // feedback going into each channel's next written sample - mNumChannels per stream
+    float* mDelayMemory; // every stream's line, mLineStride floats apart
+    size_t mLineStride;
+    int mLineLength; // in frames, power of two
+    int mLineMask;
+
+    /* The current tick - written before the ranges are opened, read by whoever claims a chunk */
+    float* const* const* mChannels;
+    int mTickSamples;
+    int64 mDeadline; // high resolution ticks, 0 for none
+    std::unique_ptr<ChunkRange[]> mRanges; // one per thread, each on its own cache line
+    std::atomic<int> mChunksDone;
+    std::atomic<int> mNumSkipped;
+
+    OwnedArray<Worker> mWorkers; // mNumThreads - 1 of them, the caller is thread 0
+
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (StreamBank)
+};
@@ -0,0 +1,82 @@
+/*
+  ==============================================================================
+
+    Telemetry.h
+    Wait-free snapshots of the engine, sent from the audio thread to the editor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+// Snapshots the FIFO can hold - a few seconds' worth, so a stalled message thread only drops frames
+# define TELEMETRY_FIFO_SIZE 256
+
+// Snapshots per second the audio thread sends while an editor is open
+# define TELEMETRY_RATE 60
+
+// Channels the telemetry reports - left and right, or the first two of a wider layout
+# define TELEMETRY_CHANNELS 2
+
+//==============================================================================
+// What the engine was doing over one telemetry interval
+struct TelemetryFrame
+{
+    float lfoPhase; // LFO phase at the end of the interval, in cycles (0 to 1)
+    float delayTimeMs[TELEMETRY_CHANNELS]; // delay of each channel's first voice at the end of the interval
+    float inputPeak[TELEMETRY_CHANNELS]; // loudest input sample over the interval
+    float outputPeak[TELEMETRY_CHANNELS]; // loudest output sample over the interval
+};
+
+//==============================================================================
+/**
+    Single producer, single consumer ring of TelemetryFrames.
+
+    The audio thread pushes and the message thread pops. Both sides only move their own end of an
+    AbstractFifo and copy a small struct, so neither ever locks, allocates or waits on the other -
+    when the ring is full the newest frame is dropped rather than blocking the audio thread.
+*/
+class TelemetryFifo
+{
+public:
+    TelemetryFifo() : mFifo(TELEMETRY_FIFO_SIZE) {}
+
+    // Audio thread - returns false if the reader has fallen behind and the frame was dropped
+    bool push(const TelemetryFrame& frame)
+    {
+        int start1, size1, start2, size2;
+        mFifo.prepareToWrite(1, start1, size1, start2, size2);
+
+        if (size1 == 0) {
+            return false;
+        }
+
+        mFrames[start1] = frame;
+        mFifo.finishedWrite(1);
+        return true;
+    }
+
+    // Message thread - returns false once there is nothing left to read
+    bool pop(TelemetryFrame& frame)
+    {
+        int start1, size1, start2, size2;
+        mFifo.prepareToRead(1, start1, size1, start2, size2);
+
+        if (size1 == 0) {
+            return false;
+        }
+
+        frame = mFrames[start1];
+        mFifo.finishedRead(1);
+        return true;
+    }
+
+private:
+    AbstractFifo mFifo;
+    TelemetryFrame mFrames[TELEMETRY_FIFO_SIZE];
+
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TelemetryFifo)
+};
@@ -0,0 +1,722 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Headless stress and soak test for ChorusFlangerAudioProcessor's host callbacks.
+
+    Drives the processor through a randomised but reproducible sequence of host callbacks - block
+    sizes of 0, 1 and odd lengths, blocks longer than prepareToPlay promised, re-prepares at changing
+    sample rates, block sizes, channel counts and host precisions, parameter storms, program changes,
+    host bypass in either bypass mode and damaged state blobs - and checks every processBlock call:
+
+      - no NaN or Inf in the output, and nothing louder than the feedback can build up to
+      - nothing written outside the host buffer (guard samples around every channel)
+      - how long it took against its deadline (the block's duration, times --deadline)
+
+    A denormal probe then times the feedback path fed with subnormal input against normal input,
+    for every host and storage precision, and a stream bank check runs StreamBank streams next to
+    engines at the same settings, through a change of every parameter, and compares their output.
+    Last, an impulse into 16-bit storage at full feedback has to die away to silence.
+
+    Usage:
+      ChorusFlangerStress [--seed=1] [--calls=20000] [--seconds=<soak this long instead>]
+                          [--deadline=1.0] [--strict-deadline] [--denormal-limit=2.0] [--verbose]
+
+    Exits with 1 on any failure, printing the seed and call count that replay it. Deadline misses
+    are reported, and only fail the run with --strict-deadline. Reads outside the buffers need a
+    sanitizer build to be seen - see the README.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../Source/PluginProcessor.h"
+#include "../../Source/StreamBank.h"
+
+// Samples of guard before and after every channel of the host buffer
+# define STRESS_GUARD_SAMPLES 64
+
+// What the guard samples hold - anything else there was written by the processor
+# define STRESS_GUARD_VALUE 1234.5
+
+// Loudest output a sound call can produce - full scale DC into 0.98 feedback settles at 50, voices and
+// the oversampling filters' overshoot add a little
+# define STRESS_OUTPUT_LIMIT 1000.0
+
+// Longest a host buffer can get - four times the largest prepared block size
+# define STRESS_MAX_BLOCK_SIZE 16384
+
+// Failures printed in full - the rest are only counted
+# define STRESS_MAX_REPORTED_FAILURES 20
+
+// Largest difference allowed between a stream bank stream and an engine at the same settings. They only part by
+// rounding - mostly the engine's LFO, a float rotor run through each block, where a stream works it out exactly -
+// which the feedback builds up to a few thousandths on noise. A wrong feedback tap or glide is ten times that.
+# define STRESS_BANK_TOLERANCE 1.0e-2
+
+// Seconds of silence after an impulse the 16-bit feedback tail gets to fall below SILENCE_THRESHOLD - at 0.98 it takes
+// a few seconds to get down to its last steps, and rounding toward zero takes one off every trip after that
+# define STRESS_COMPACT_TAIL_SECONDS 30
+
+// Host settings a re-prepare picks from. A rate above the last prepare's makes the delay memory grow.
+static const double sampleRates[] = { 8000, 22050, 44100, 48000, 88200, 96000, 176400, 192000, 384000, 768000 };
+static const int preparedBlockSizes[] = { 1, 16, 32, 64, 100, 128, 256, 441, 512, 1024, 2048, 4096 };
+static const int channelCounts[] = { 1, 2, 3, 6, 8, 16 };
+static const int oddBlockSizes[] = { 7, 13, 127, 257, 1021, 4099 };
+
+// Input signals - each runs for a random number of calls, so silence lasts long enough for the core to sleep
+enum StressInput
+{
+    noiseInput = 0,
+    silentInput,
+    loudInput, // full scale square wave with DC - drives the feedback as hard as it goes
+    impulseInput,
+    subnormalInput, // subnormal noise, with one audible sample per block to keep the core awake
+    NUM_STRESS_INPUTS
+};
+
+static const char* const inputNames[NUM_STRESS_INPUTS] = { "noise", "silence", "loud", "impulses", "subnormal" };
+
+//==============================================================================
+struct StressSettings
+{
+    int64 seed;
+    int64 numCalls;
+    double seconds; // 0 = run numCalls
+    double deadlineFraction;
+    bool strictDeadline;
+    double denormalLimit;
+    bool verbose;
+};
+
+// The host as the processor last saw it prepared
+struct HostState
+{
+    double sampleRate;
+    int blockSize;
+    int numChannels;
+    bool doublePrecision;
+    bool bypassed = false; // processBlockBypassed instead of processBlock - kept across prepares, as a host does
+};
+
+struct StressResults
+{
+    int64 numCalls = 0;
+    int64 numPrepares = 0;
+    double secondsProcessed = 0; // audio, at whatever rate each call ran at
+    double worstSeconds = 0;
+    double worstLoad = 0; // call time over block duration
+    String worstSecondsCall;
+    String worstLoadCall;
+    int64 numDeadlineMisses = 0;
+    int64 numFailures = 0;
+};
+
+//==============================================================================
+static void fail(StressResults& results, const String& message)
+{
+    if (results.numFailures < STRESS_MAX_REPORTED_FAILURES) {
+        std::cout << "FAIL " << message << std::endl;
+    }
+
+    results.numFailures++;
+}
+
+static String describeCall(int64 call, const HostState& host, int numSamples, int input)
+{
+    return "call " + String(call) + ": " + String((int)host.sampleRate) + " Hz, " + String(host.numChannels) + " ch, "
+           + (host.doublePrecision ? "double" : "float") + ", block " + String(numSamples) + " of "
+           + String(host.blockSize) + ", " + inputNames[input] + (host.bypassed ? ", bypassed" : "");
+}
+
+// Picks a block size the way a hostile host might - mostly what it promised, often not
+static int pickBlockSize(Random& random, int preparedBlockSize)
+{
+    const int dice = random.nextInt(100);
+
+    if (dice < 3) {
+        return 0;
+    }
+    if (dice < 28) {
+        return 1 + random.nextInt(4);
+    }
+    if (dice < 53) {
+        return 1 + random.nextInt(preparedBlockSize);
+    }
+    if (dice < 73) {
+        return preparedBlockSize;
+    }
+    if (dice < 93) {
+        return jmin(STRESS_MAX_BLOCK_SIZE, preparedBlockSize + 1 + random.nextInt(preparedBlockSize * 3)); // longer than promised
+    }
+
+    return oddBlockSizes[random.nextInt(numElementsInArray(oddBlockSizes))];
+}
+
+template <typename SampleType>
+static SampleType getInputSample(int input, int64 position, Random& random)
+{
+    switch (input) {
+        case noiseInput:
+            return SampleType(random.nextFloat() - 0.5f);
+        case loudInput:
+            return ((position / 100) % 2 == 0) ? SampleType(1) : SampleType(0.2);
+        case impulseInput:
+            return (position % 4410 == 0) ? SampleType(1) : SampleType(0);
+        case subnormalInput:
+            // Below the smallest normal number of the host's precision, apart from one sample per block
+            return SampleType(random.nextFloat()) * std::numeric_limits<SampleType>::denorm_min() * SampleType(1000);
+        default:
+            return SampleType(0);
+    }
+}
+
+//==============================================================================
+// The host buffer - every channel with guard samples either side
+template <typename SampleType>
+class GuardedBuffer
+{
+public:
+    void allocate(int numChannels)
+    {
+        mNumChannels = numChannels;
+        mStride = STRESS_MAX_BLOCK_SIZE + 2 * STRESS_GUARD_SAMPLES;
+        mData.malloc((size_t)(mNumChannels * mStride));
+    }
+
+    // Fills the guards, and wraps numSamples samples of every channel in an AudioBuffer that refers to them
+    AudioBuffer<SampleType> prepare(int numSamples)
+    {
+        for (int channel = 0; channel < mNumChannels; channel++) {
+            SampleType* data = mData + channel * mStride;
+
+            for (int i = 0; i < STRESS_GUARD_SAMPLES; i++) {
+                data[i] = SampleType(STRESS_GUARD_VALUE);
+                data[STRESS_GUARD_SAMPLES + numSamples + i] = SampleType(STRESS_GUARD_VALUE);
+            }
+
+            mChannels[channel] = data + STRESS_GUARD_SAMPLES;
+        }
+
+        return AudioBuffer<SampleType>(mChannels, mNumChannels, numSamples);
+    }
+
+    // Finds the first guard sample that changed - position is counted from the channel's first sample, so
+    // damage before the buffer comes out negative
+    bool findDamagedGuard(int channel, int numSamples, int& position) const
+    {
+        const SampleType* data = mData + channel * mStride;
+
+        for (int i = 0; i < STRESS_GUARD_SAMPLES; i++) {
+            if (data[i] != SampleType(STRESS_GUARD_VALUE)) {
+                position = i - STRESS_GUARD_SAMPLES;
+                return true;
+            }
+            if (data[STRESS_GUARD_SAMPLES + numSamples + i] != SampleType(STRESS_GUARD_VALUE)) {
+                position = numSamples + i;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+private:
+    HeapBlock<SampleType> mData;
+    SampleType* mChannels[MAX_CHANNELS];
+    int mNumChannels = 0;
+    int mStride = 0;
+};
+
+//==============================================================================
+// What the message thread does between callbacks - re-prepare, change program, load a state, automate
+static void prepare(ChorusFlangerAudioProcessor& processor, HostState& host, Random& random, StressResults& results)
+{
+    // Sometimes the way a host stops and restarts, sometimes a straight re-prepare
+    if (random.nextBool()) {
+        processor.releaseResources();
+    }
+
+    host.sampleRate = sampleRates[random.nextInt(numElementsInArray(sampleRates))];
+    host.blockSize = preparedBlockSizes[random.nextInt(numElementsInArray(preparedBlockSizes))];
+    host.numChannels = channelCounts[random.nextInt(numElementsInArray(channelCounts))];
+    host.doublePrecision = random.nextBool();
+
+    processor.setPlayConfigDetails(host.numChannels, host.numChannels, host.sampleRate, host.blockSize);
+    processor.setProcessingPrecision(host.doublePrecision ? AudioProcessor::doublePrecision : AudioProcessor::singlePrecision);
+    processor.prepareToPlay(host.sampleRate, host.blockSize);
+
+    results.numPrepares++;
+}
+
+static void loadDamagedState(ChorusFlangerAudioProcessor& processor, Random& random)
+{
+    MemoryBlock state;
+    processor.getStateInformation(state);
+
+    switch (random.nextInt(4)) {
+        case 0: // cut short
+            state.setSize((size_t)random.nextInt((int)state.getSize() + 1));
+            break;
+        case 1: // a few bytes flipped - values can come out as NaN, Inf or far out of range
+            for (int flip = 0; flip < 4; flip++) {
+                ((uint8*)state.getData())[random.nextInt((int)state.getSize())] ^= (uint8)(1 << random.nextInt(8));
+            }
+            break;
+        case 2: { // a value that isn't a number - the header is four ints, the values follow
+            const float values[] = { std::numeric_limits<float>::quiet_NaN(), std::numeric_limits<float>::infinity(),
+                                     -std::numeric_limits<float>::infinity() };
+            const int numValues = ((int)state.getSize() - 4 * (int)sizeof(int)) / (int)sizeof(float);
+
+            if (numValues > 0) {
+                memcpy((char*)state.getData() + 4 * sizeof(int) + (size_t)random.nextInt(numValues) * sizeof(float),
+                       &values[random.nextInt(numElementsInArray(values))], sizeof(float));
+            }
+            break;
+        }
+        default: // not a state at all
+            state.setSize((size_t)random.nextInt(64));
+
+            for (size_t i = 0; i < state.getSize(); i++) {
+                ((uint8*)state.getData())[i] = (uint8)random.nextInt(256);
+            }
+            break;
+    }
+
+    processor.setStateInformation(state.getData(), (int)state.getSize());
+}
+
+static void automate(AudioProcessor& processor, Random& random)
+{
+    // Every parameter has a chance to jump, the discrete ones included - each of those restarts part of the core
+    for (auto* parameter : processor.getParameters()) {
+        if (random.nextInt(4) == 0) {
+            parameter->setValueNotifyingHost(random.nextFloat());
+        }
+    }
+}
+
+//==============================================================================
+// One processBlock call, checked
+template <typename SampleType>
+static void runCall(ChorusFlangerAudioProcessor& processor, GuardedBuffer<SampleType>& guarded, const HostState& host,
+                    int numSamples, int input, int64 call, int64& position, Random& random, const StressSettings& settings,
+                    StressResults& results)
+{
+    AudioBuffer<SampleType> buffer = guarded.prepare(numSamples);
+    MidiBuffer midi;
+
+    for (int channel = 0; channel < host.numChannels; channel++) {
+        SampleType* data = buffer.getWritePointer(channel);
+
+        for (int i = 0; i < numSamples; i++) {
+            data[i] = getInputSample<SampleType>(input, position + i, random);
+        }
+
+        if (input == subnormalInput && numSamples > 0) {
+            data[0] = SampleType(0.001);
+        }
+    }
+
+    const int64 start = Time::getHighResolutionTicks();
+    if (host.bypassed) {
+        processor.processBlockBypassed(buffer, midi);
+    }
+    else {
+        processor.processBlock(buffer, midi);
+    }
+
+    const double seconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start);
+
+    position += numSamples;
+    results.numCalls++;
+    results.secondsProcessed += numSamples / host.sampleRate;
+
+    // Time against the block's share of real time
+    if (seconds > results.worstSeconds) {
+        results.worstSeconds = seconds;
+        results.worstSecondsCall = describeCall(call, host, numSamples, input);
+    }
+
+    if (numSamples > 0) {
+        const double load = seconds * host.sampleRate / numSamples;
+
+        if (load > results.worstLoad) {
+            results.worstLoad = load;
+            results.worstLoadCall = describeCall(call, host, numSamples, input);
+        }
+
+        if (load > settings.deadlineFraction) {
+            results.numDeadlineMisses++;
+
+            if (settings.verbose) {
+                std::cout << "deadline missed (" << String(load, 2) << " of the block) - "
+                          << describeCall(call, host, numSamples, input) << std::endl;
+            }
+        }
+    }
+
+    // The output, and the memory around it
+    for (int channel = 0; channel < host.numChannels; channel++) {
+        const SampleType* data = buffer.getReadPointer(channel);
+
+        for (int i = 0; i < numSamples; i++) {
+            if (! std::isfinite(data[i]) || std::abs(data[i]) > SampleType(STRESS_OUTPUT_LIMIT)) {
+                fail(results, "output " + String((double)data[i]) + " at channel " + String(channel) + " sample " + String(i)
+                              + " - " + describeCall(call, host, numSamples, input));
+                break;
+            }
+        }
+
+        int damaged;
+
+        if (guarded.findDamagedGuard(channel, numSamples, damaged)) {
+            fail(results, "write outside the buffer at channel " + String(channel) + " sample " + String(damaged)
+                          + " - " + describeCall(call, host, numSamples, input));
+        }
+    }
+}
+
+static StressResults runStress(const StressSettings& settings)
+{
+    StressResults results;
+    Random random(settings.seed);
+
+    ChorusFlangerAudioProcessor processor;
+    GuardedBuffer<float> floatBuffer;
+    GuardedBuffer<double> doubleBuffer;
+    floatBuffer.allocate(MAX_CHANNELS);
+    doubleBuffer.allocate(MAX_CHANNELS);
+
+    HostState host;
+    prepare(processor, host, random, results);
+
+    int input = noiseInput;
+    int64 inputUntil = 0;
+    int64 position = 0;
+
+    const int64 endTime = Time::getHighResolutionTicks() + Time::secondsToHighResolutionTicks(settings.seconds);
+
+    for (int64 call = 0; (settings.seconds > 0) ? (Time::getHighResolutionTicks() < endTime) : (call < settings.numCalls); call++) {
+
+        // Between callbacks
+        const int dice = random.nextInt(1000);
+
+        if (dice < 5) {
+            prepare(processor, host, random, results);
+        }
+        else if (dice < 10) {
+            processor.setCurrentProgram(random.nextInt(processor.getNumPrograms()));
+        }
+        else if (dice < 15) {
+            loadDamagedState(processor, random);
+        }
+        else if (dice < 25) {
+            host.bypassed = ! host.bypassed;
+            processor.setBypassMode(random.nextBool() ? ChorusFlangerAudioProcessor::BypassMode::keepFed
+                                                      : ChorusFlangerAudioProcessor::BypassMode::sleep);
+        }
+
+        if (random.nextInt(3) == 0) {
+            automate(processor, random);
+        }
+
+        if (call >= inputUntil) {
+            input = random.nextInt(NUM_STRESS_INPUTS);
+            inputUntil = call + 1 + random.nextInt(2000);
+        }
+
+        const int numSamples = pickBlockSize(random, host.blockSize);
+
+        if (host.doublePrecision) {
+            runCall(processor, doubleBuffer, host, numSamples, input, call, position, random, settings, results);
+        }
+        else {
+            runCall(processor, floatBuffer, host, numSamples, input, call, position, random, settings, results);
+        }
+
+        if (settings.verbose && results.numCalls % 10000 == 0) {
+            std::cout << results.numCalls << " calls, worst load " << String(results.worstLoad, 3) << std::endl;
+        }
+    }
+
+    return results;
+}
+
+//==============================================================================
+// Time for a fixed run of blocks of one input, best of a few tries so a preempted try doesn't count
+template <typename SampleType>
+static double timeInput(int storage, int input)
+{
+    const double sampleRate = 48000.0;
+    const int blockSize = 256;
+    const int numBlocks = 400;
+    double best = 0;
+
+    for (int attempt = 0; attempt < 3; attempt++) {
+        ChorusFlangerAudioProcessor processor;
+        processor.setPlayConfigDetails(2, 2, sampleRate, blockSize);
+        processor.setProcessingPrecision(std::is_same<SampleType, double>::value ? AudioProcessor::doublePrecision
+                                                                                  : AudioProcessor::singlePrecision);
+
+        auto& parameters = processor.getParameters();
+        parameters.getUnchecked(0)->setValueNotifyingHost(1.0f); // all wet, so the feedback path is all that is heard
+        parameters.getUnchecked(4)->setValueNotifyingHost(1.0f); // feedback as high as it goes
+        parameters.getUnchecked(9)->setValueNotifyingHost((float)storage / (NUM_DELAY_PRECISIONS - 1));
+
+        processor.prepareToPlay(sampleRate, blockSize);
+
+        AudioBuffer<SampleType> buffer(2, blockSize);
+        MidiBuffer midi;
+        Random random(1);
+        int64 position = 0;
+        int64 ticks = 0;
+
+        for (int block = 0; block < numBlocks; block++) {
+            for (int channel = 0; channel < 2; channel++) {
+                for (int i = 0; i < blockSize; i++) {
+                    buffer.setSample(channel, i, getInputSample<SampleType>(input, position + i, random));
+                }
+
+                buffer.setSample(channel, 0, SampleType(0.001)); // keeps the core awake
+            }
+
+            position += blockSize;
+
+            const int64 start = Time::getHighResolutionTicks();
+            processor.processBlock(buffer, midi);
+
+            // The first blocks fill the line - only time the ones where the feedback is circulating
+            if (block >= numBlocks / 4) {
+                ticks += Time::getHighResolutionTicks() - start;
+            }
+        }
+
+        const double seconds = Time::highResolutionTicksToSeconds(ticks);
+        best = (attempt == 0) ? seconds : jmin(best, seconds);
+    }
+
+    return best;
+}
+
+// Denormals in the feedback path show up as subnormal input costing more than normal input
+static bool probeDenormals(double limit, StressResults& results)
+{
+    static const char* const storageNames[NUM_DELAY_PRECISIONS] = { "32", "64", "16" };
+    bool passed = true;
+
+    std::cout << std::endl << "Denormal probe (feedback 0.98, all wet, 48 kHz, 256 samples)" << std::endl;
+
+    for (int hostDouble = 0; hostDouble < 2; hostDouble++) {
+        for (int storage = 0; storage < NUM_DELAY_PRECISIONS; storage++) {
+            const double normal = hostDouble ? timeInput<double>(storage, noiseInput) : timeInput<float>(storage, noiseInput);
+            const double subnormal = hostDouble ? timeInput<double>(storage, subnormalInput) : timeInput<float>(storage, subnormalInput);
+            const double ratio = subnormal / normal;
+
+            std::cout << "host " << String(hostDouble ? "double" : "float").paddedRight(' ', 7)
+                      << "storage " << String(storageNames[storage]).paddedRight(' ', 4)
+                      << "subnormal/normal " << String(ratio, 2) << std::endl;
+
+            if (ratio > limit) {
+                fail(results, "subnormal input costs " + String(ratio, 2) + "x normal input (host "
+                              + (hostDouble ? "double" : "float") + ", storage " + storageNames[storage] + " bit)");
+                passed = false;
+            }
+        }
+    }
+
+    return passed;
+}
+
+// Stream bank streams against engines at the same settings - one voice, linear, no oversampling, 32-bit storage
+static bool checkStreamBank(StressResults& results)
+{
+    const double sampleRate = 48000.0;
+    const int blockSize = 256;
+    const int numBlocks = 200;
+    const int numChannels = 2;
+
+    // Every stream takes the next one's settings halfway through, so every parameter glides (and the type switches)
+    static const StreamParameters settings[] = {
+        { 0.5f, 0.5f, 10.0f, 0.0f, 0.5f, 0 },
+        { 1.0f, 1.0f, 0.3f, 0.5f, 0.98f, 1 },
+        { 0.3f, 0.2f, 20.0f, 1.0f, 0.0f, 0 },
+        { 0.8f, 0.9f, 2.0f, 0.25f, 0.9f, 1 }
+    };
+
+    const int numStreams = numElementsInArray(settings);
+
+    auto toEngineParameters = [](const StreamParameters& parameters) {
+        ChorusFlangerParameters engineParameters;
+        engineParameters.dryWet = parameters.dryWet;
+        engineParameters.depth = parameters.depth;
+        engineParameters.rate = parameters.rate;
+        engineParameters.phaseOffset = parameters.phaseOffset;
+        engineParameters.feedback = parameters.feedback;
+        engineParameters.type = parameters.type;
+        return engineParameters;
+    };
+
+    StreamBank bank;
+    bank.prepare(numStreams, numChannels, sampleRate, blockSize, 1);
+
+    OwnedArray<ChorusFlangerEngine> engines;
+    std::vector<AudioBuffer<float>> bankBuffers, engineBuffers;
+    std::vector<float* const*> streams;
+
+    for (int stream = 0; stream < numStreams; stream++) {
+        bank.setParameters(stream, settings[stream]);
+        bank.reset(stream);
+
+        auto* engine = engines.add(new ChorusFlangerEngine());
+        engine->setParameters(toEngineParameters(settings[stream]));
+        engine->prepare(sampleRate, blockSize, numChannels);
+
+        bankBuffers.emplace_back(numChannels, blockSize);
+        engineBuffers.emplace_back(numChannels, blockSize);
+    }
+
+    for (auto& buffer : bankBuffers) {
+        streams.push_back(buffer.getArrayOfWritePointers());
+    }
+
+    Random random(1);
+    double worst = 0;
+
+    for (int block = 0; block < numBlocks; block++) {
+        if (block == numBlocks / 2) {
+            for (int stream = 0; stream < numStreams; stream++) {
+                bank.setParameters(stream, settings[(stream + 1) % numStreams]);
+                engines[stream]->setParameters(toEngineParameters(settings[(stream + 1) % numStreams]));
+            }
+        }
+
+        for (int stream = 0; stream < numStreams; stream++) {
+            for (int channel = 0; channel < numChannels; channel++) {
+                for (int i = 0; i < blockSize; i++) {
+                    const float sample = 0.5f * (random.nextFloat() * 2.0f - 1.0f);
+                    bankBuffers[stream].setSample(channel, i, sample);
+                    engineBuffers[stream].setSample(channel, i, sample);
+                }
+            }
+
+            engines[stream]->process(engineBuffers[stream].getArrayOfWritePointers(), numChannels, blockSize);
+        }
+
+        bank.process(streams.data(), blockSize);
+
+        for (int stream = 0; stream < numStreams; stream++) {
+            for (int channel = 0; channel < numChannels; channel++) {
+                for (int i = 0; i < blockSize; i++) {
+                    worst = jmax(worst, (double)std::abs(bankBuffers[stream].getSample(channel, i)
+                                                         - engineBuffers[stream].getSample(channel, i)));
+                }
+            }
+        }
+    }
+
+    std::cout << std::endl << "Stream bank check (" << numStreams << " streams, 48 kHz, 256 samples)" << std::endl;
+    std::cout << "max difference   " << String(worst, 7) << " (limit " << String(STRESS_BANK_TOLERANCE, 7) << ")" << std::endl;
+
+    if (! (worst <= STRESS_BANK_TOLERANCE)) {
+        fail(results, "stream bank output is " + String(worst, 7) + " from the engine's");
+        return false;
+    }
+
+    return true;
+}
+
+// An impulse into 16-bit storage at feedback 0.98, then silence - the tail has to reach SILENCE_THRESHOLD, or the
+// engine can never sleep
+static bool checkCompactTail(StressResults& results)
+{
+    const double sampleRate = 48000.0;
+    const int blockSize = 256;
+    const int numChannels = 2;
+    const int numBlocks = (int)(STRESS_COMPACT_TAIL_SECONDS * sampleRate) / blockSize;
+
+    ChorusFlangerParameters parameters;
+    parameters.dryWet = 1.0f; // all wet, so the feedback tail is all that is heard
+    parameters.feedback = 0.98f;
+    parameters.delayPrecision = 2;
+
+    ChorusFlangerEngine engine;
+    engine.setParameters(parameters);
+    engine.prepare(sampleRate, blockSize, numChannels);
+
+    AudioBuffer<float> buffer(numChannels, blockSize);
+    float tailPeak = 0;
+
+    for (int block = 0; block < numBlocks; block++) {
+        buffer.clear();
+
+        if (block == 0) {
+            for (int channel = 0; channel < numChannels; channel++) {
+                buffer.setSample(channel, 0, 1.0f);
+            }
+        }
+
+        engine.process(buffer.getArrayOfWritePointers(), numChannels, blockSize);
+
+        // Only the last second counts
+        if (block >= numBlocks - (int)sampleRate / blockSize) {
+            tailPeak = jmax(tailPeak, buffer.getMagnitude(0, blockSize));
+        }
+    }
+
+    std::cout << std::endl << "16-bit tail check (impulse, feedback 0.98, " << STRESS_COMPACT_TAIL_SECONDS << " s)" << std::endl;
+    std::cout << "tail peak        " << String(tailPeak, 7) << " (limit " << String(SILENCE_THRESHOLD, 7) << ")" << std::endl;
+
+    if (! (tailPeak < SILENCE_THRESHOLD)) {
+        fail(results, "16-bit feedback tail is still at " + String(tailPeak, 7) + " after "
+                      + String(STRESS_COMPACT_TAIL_SECONDS) + " s");
+        return false;
+    }
+
+    return true;
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    ScopedJuceInitialiser_GUI juceInitialiser; // the processor publishes preset changes through the message thread
+
+    ArgumentList args(argc, argv);
+
+    StressSettings settings;
+    settings.seed = args.containsOption("--seed") ? args.getValueForOption("--seed").getLargeIntValue() : 1;
+    settings.numCalls = args.containsOption("--calls") ? args.getValueForOption("--calls").getLargeIntValue() : 20000;
+    settings.seconds = args.containsOption("--seconds") ? args.getValueForOption("--seconds").getDoubleValue() : 0.0;
+    settings.deadlineFraction = args.containsOption("--deadline") ? args.getValueForOption("--deadline").getDoubleValue() : 1.0;
+    settings.strictDeadline = args.containsOption("--strict-deadline");
+    settings.denormalLimit = args.containsOption("--denormal-limit") ? args.getValueForOption("--denormal-limit").getDoubleValue() : 2.0;
+    settings.verbose = args.containsOption("--verbose");
+
+    StressResults results = runStress(settings);
+
+    std::cout << "Stress (seed " << settings.seed << ", " << results.numCalls << " calls, " << results.numPrepares
+              << " prepares, " << String(results.secondsProcessed, 1) << " s of audio)" << std::endl;
+    std::cout << "worst call       " << String(results.worstSeconds * 1.0e6, 1) << " us - " << results.worstSecondsCall << std::endl;
+    std::cout << "worst load       " << String(results.worstLoad, 3) << " of the block - " << results.worstLoadCall << std::endl;
+    std::cout << "deadline misses  " << results.numDeadlineMisses << " (deadline " << String(settings.deadlineFraction, 2)
+              << " of the block)" << std::endl;
+
+    probeDenormals(settings.denormalLimit, results);
+    checkStreamBank(results);
+    checkCompactTail(results);
+
+    if (settings.strictDeadline && results.numDeadlineMisses > 0) {
+        fail(results, String(results.numDeadlineMisses) + " calls missed the deadline");
+    }
+
+    std::cout << std::endl;
+
+    if (results.numFailures > 0) {
+        std::cout << results.numFailures << " failures - replay with --seed=" << settings.seed << " --calls=" << results.numCalls
+                  << " (the call numbers above count from 0)" << std::endl;
+        return 1;
+    }
+
+    std::cout << "No failures" << std::endl;
+    return 0;
+}